@@ -39,6 +39,30 @@
     // so we must normalize these for the ARM processor:
     #define PROGMEM
     #define memcpy_P(dest, src, num) memcpy((dest), (src), (num))
+
+    #include <unistd.h> /* read, close */
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <errno.h>
+    #include <sys/ioctl.h>
+    #include <linux/gpio.h>
+    #include <pthread.h>
+#endif
+
+#if defined(RaspberryPi)
+    // wiringPi runs the interrupt handler in a thread of its own. The keys
+    // of piLock() belong to the application, so we use a mutex of our own.
+    static pthread_mutex_t receiveMutex = PTHREAD_MUTEX_INITIALIZER;
+    #define RECEIVE_ISR_LOCK() pthread_mutex_lock(&receiveMutex)
+    #define RECEIVE_ISR_UNLOCK() pthread_mutex_unlock(&receiveMutex)
+    #define RECEIVE_LOCK() pthread_mutex_lock(&receiveMutex)
+    #define RECEIVE_UNLOCK() pthread_mutex_unlock(&receiveMutex)
+#else
+    #define RECEIVE_ISR_LOCK()
+    #define RECEIVE_ISR_UNLOCK()
+    #define RECEIVE_LOCK() noInterrupts()
+    #define RECEIVE_UNLOCK() interrupts()
 #endif
 
 #if defined(ESP8266)
@@ -54,6 +78,23 @@
     #define VAR_ISR_ATTR
 #endif
 
+#if defined( RCSWITCH_REPORT_FOOTPRINT )
+    // print the sizes of the receive buffers next to the sketch size the
+    // IDE reports, the rest of the receive state is listed in the README
+    #if !defined( RCSWITCH_COMPACT_TIMINGS )
+      #define RCSWITCH_TIMING_SIZE __SIZEOF_INT__
+    #elif RCSWITCH_COMPACT_TIMINGS == 8
+      #define RCSWITCH_TIMING_SIZE 1
+    #else
+      #define RCSWITCH_TIMING_SIZE 2
+    #endif
+    #define RCSWITCH_STR2(x) #x
+    #define RCSWITCH_STR(x) RCSWITCH_STR2(x)
+    #pragma message("RCSwitch: timings take " RCSWITCH_STR(RCSWITCH_MAX_CHANGES) " x " RCSWITCH_STR(RCSWITCH_TIMING_SIZE) \
+                    " bytes (" RCSWITCH_STR(RCSWITCH_TIMING_TICK) "us ticks), the event API queues up to " \
+                    RCSWITCH_STR(RCSWITCH_MAX_EVENTS) " events if used")
+#endif
+
 
 /* Format for protocol definitions:
  * {pulselength, Sync bit, "0" bit, "1" bit, invertedSignal}
@@ -102,12 +143,29 @@ volatile unsigned long RCSwitch::nReceivedValue = 0;
 volatile unsigned int RCSwitch::nReceivedBitlength = 0;
 volatile unsigned int RCSwitch::nReceivedDelay = 0;
 volatile unsigned int RCSwitch::nReceivedProtocol = 0;
+volatile unsigned int RCSwitch::nReceivedDevice = RCSWITCH_NO_DEVICE;
 int RCSwitch::nReceiveTolerance = 60;
 const unsigned int VAR_ISR_ATTR RCSwitch::nSeparationLimit = 4300;
 // separationLimit: minimum microseconds between received codes, closer codes are ignored.
 // according to discussion on issue #14 it might be more suitable to set the separation
 // limit to the same time as the 'low' part of the sync signal for the current protocol.
-unsigned int RCSwitch::timings[RCSWITCH_MAX_CHANGES];
+RCSwitch::Timing RCSwitch::timings[RCSWITCH_MAX_CHANGES];
+const RCSwitch::CodebookEntry* RCSwitch::codebook = 0;
+unsigned int RCSwitch::nCodebookSize = 0;
+bool RCSwitch::bCodebookFilter = false;
+void (*RCSwitch::eventRecorder)(const int p) = 0;
+RCSwitch::Event RCSwitch::currentEvent;
+unsigned long RCSwitch::nLastSeen = 0;
+bool RCSwitch::bEventActive = false;
+RCSwitch::Event RCSwitch::events[RCSWITCH_MAX_EVENTS];
+volatile uint8_t RCSwitch::nEventTail = 0;
+volatile uint8_t RCSwitch::nEventCount = 0;
+
+// hold and release timeouts in milliseconds, per protocol (0 = default)
+static unsigned int nDefaultHoldTimeout = 500;
+static unsigned int nDefaultReleaseTimeout = 250;
+static uint16_t holdTimeouts[numProto];
+static uint16_t releaseTimeouts[numProto];
 #endif
 
 RCSwitch::RCSwitch() {
@@ -118,6 +176,12 @@ RCSwitch::RCSwitch() {
   this->nReceiverInterrupt = -1;
   this->setReceiveTolerance(60);
   RCSwitch::nReceivedValue = 0;
+  #if defined(RaspberryPi)
+  this->nReceiverFd = -1;
+  this->nEventStart = 0;
+  this->nEventEnd = 0;
+  this->sampleState.rate = 0;
+  #endif
   #endif
 }
 
@@ -199,7 +263,7 @@ void RCSwitch::disableTransmit() {
  * @param nDevice       Number of the switch itself (1..3)
  */
 void RCSwitch::switchOn(char sGroup, int nDevice) {
-  this->sendTriState( this->getCodeWordD(sGroup, nDevice, true) );
+  this->send( RCSwitch::codeWordD(sGroup, nDevice, true) );
 }
 
 /**
@@ -209,7 +273,7 @@ void RCSwitch::switchOn(char sGroup, int nDevice) {
  * @param nDevice       Number of the switch itself (1..3)
  */
 void RCSwitch::switchOff(char sGroup, int nDevice) {
-  this->sendTriState( this->getCodeWordD(sGroup, nDevice, false) );
+  this->send( RCSwitch::codeWordD(sGroup, nDevice, false) );
 }
 
 /**
@@ -220,7 +284,7 @@ void RCSwitch::switchOff(char sGroup, int nDevice) {
  * @param nDevice  Number of device (1..4)
   */
 void RCSwitch::switchOn(char sFamily, int nGroup, int nDevice) {
-  this->sendTriState( this->getCodeWordC(sFamily, nGroup, nDevice, true) );
+  this->send( RCSwitch::codeWordC(sFamily, nGroup, nDevice, true) );
 }
 
 /**
@@ -231,7 +295,7 @@ void RCSwitch::switchOn(char sFamily, int nGroup, int nDevice) {
  * @param nDevice  Number of device (1..4)
  */
 void RCSwitch::switchOff(char sFamily, int nGroup, int nDevice) {
-  this->sendTriState( this->getCodeWordC(sFamily, nGroup, nDevice, false) );
+  this->send( RCSwitch::codeWordC(sFamily, nGroup, nDevice, false) );
 }
 
 /**
@@ -241,7 +305,7 @@ void RCSwitch::switchOff(char sFamily, int nGroup, int nDevice) {
  * @param nChannelCode  Number of the switch itself (1..4)
  */
 void RCSwitch::switchOn(int nAddressCode, int nChannelCode) {
-  this->sendTriState( this->getCodeWordB(nAddressCode, nChannelCode, true) );
+  this->send( RCSwitch::codeWordB(nAddressCode, nChannelCode, true) );
 }
 
 /**
@@ -251,7 +315,7 @@ void RCSwitch::switchOn(int nAddressCode, int nChannelCode) {
  * @param nChannelCode  Number of the switch itself (1..4)
  */
 void RCSwitch::switchOff(int nAddressCode, int nChannelCode) {
-  this->sendTriState( this->getCodeWordB(nAddressCode, nChannelCode, false) );
+  this->send( RCSwitch::codeWordB(nAddressCode, nChannelCode, false) );
 }
 
 /**
@@ -285,7 +349,7 @@ void RCSwitch::switchOff(const char* sGroup, int nChannel) {
  * @param sDevice       Code of the switch device (refers to DIP switches 6..10 (A..E) where "1" = on and "0" = off, if all DIP switches are on it's "11111")
  */
 void RCSwitch::switchOn(const char* sGroup, const char* sDevice) {
-  this->sendTriState( this->getCodeWordA(sGroup, sDevice, true) );
+  this->send( RCSwitch::codeWordA(sGroup, sDevice, true) );
 }
 
 /**
@@ -295,157 +359,9 @@ void RCSwitch::switchOn(const char* sGroup, const char* sDevice) {
  * @param sDevice       Code of the switch device (refers to DIP switches 6..10 (A..E) where "1" = on and "0" = off, if all DIP switches are on it's "11111")
  */
 void RCSwitch::switchOff(const char* sGroup, const char* sDevice) {
-  this->sendTriState( this->getCodeWordA(sGroup, sDevice, false) );
-}
-
-
-/**
- * Returns a char[13], representing the code word to be send.
- *
- */
-char* RCSwitch::getCodeWordA(const char* sGroup, const char* sDevice, bool bStatus) {
-  static char sReturn[13];
-  int nReturnPos = 0;
-
-  for (int i = 0; i < 5; i++) {
-    sReturn[nReturnPos++] = (sGroup[i] == '0') ? 'F' : '0';
-  }
-
-  for (int i = 0; i < 5; i++) {
-    sReturn[nReturnPos++] = (sDevice[i] == '0') ? 'F' : '0';
-  }
-
-  sReturn[nReturnPos++] = bStatus ? '0' : 'F';
-  sReturn[nReturnPos++] = bStatus ? 'F' : '0';
-
-  sReturn[nReturnPos] = '\0';
-  return sReturn;
-}
-
-/**
- * Encoding for type B switches with two rotary/sliding switches.
- *
- * The code word is a tristate word and with following bit pattern:
- *
- * +-----------------------------+-----------------------------+----------+------------+
- * | 4 bits address              | 4 bits address              | 3 bits   | 1 bit      |
- * | switch group                | switch number               | not used | on / off   |
- * | 1=0FFF 2=F0FF 3=FF0F 4=FFF0 | 1=0FFF 2=F0FF 3=FF0F 4=FFF0 | FFF      | on=F off=0 |
- * +-----------------------------+-----------------------------+----------+------------+
- *
- * @param nAddressCode  Number of the switch group (1..4)
- * @param nChannelCode  Number of the switch itself (1..4)
- * @param bStatus       Whether to switch on (true) or off (false)
- *
- * @return char[13], representing a tristate code word of length 12
- */
-char* RCSwitch::getCodeWordB(int nAddressCode, int nChannelCode, bool bStatus) {
-  static char sReturn[13];
-  int nReturnPos = 0;
-
-  if (nAddressCode < 1 || nAddressCode > 4 || nChannelCode < 1 || nChannelCode > 4) {
-    return 0;
-  }
-
-  for (int i = 1; i <= 4; i++) {
-    sReturn[nReturnPos++] = (nAddressCode == i) ? '0' : 'F';
-  }
-
-  for (int i = 1; i <= 4; i++) {
-    sReturn[nReturnPos++] = (nChannelCode == i) ? '0' : 'F';
-  }
-
-  sReturn[nReturnPos++] = 'F';
-  sReturn[nReturnPos++] = 'F';
-  sReturn[nReturnPos++] = 'F';
-
-  sReturn[nReturnPos++] = bStatus ? 'F' : '0';
-
-  sReturn[nReturnPos] = '\0';
-  return sReturn;
-}
-
-/**
- * Like getCodeWord (Type C = Intertechno)
- */
-char* RCSwitch::getCodeWordC(char sFamily, int nGroup, int nDevice, bool bStatus) {
-  static char sReturn[13];
-  int nReturnPos = 0;
-
-  int nFamily = (int)sFamily - 'a';
-  if ( nFamily < 0 || nFamily > 15 || nGroup < 1 || nGroup > 4 || nDevice < 1 || nDevice > 4) {
-    return 0;
-  }
-  
-  // encode the family into four bits
-  sReturn[nReturnPos++] = (nFamily & 1) ? 'F' : '0';
-  sReturn[nReturnPos++] = (nFamily & 2) ? 'F' : '0';
-  sReturn[nReturnPos++] = (nFamily & 4) ? 'F' : '0';
-  sReturn[nReturnPos++] = (nFamily & 8) ? 'F' : '0';
-
-  // encode the device and group
-  sReturn[nReturnPos++] = ((nDevice-1) & 1) ? 'F' : '0';
-  sReturn[nReturnPos++] = ((nDevice-1) & 2) ? 'F' : '0';
-  sReturn[nReturnPos++] = ((nGroup-1) & 1) ? 'F' : '0';
-  sReturn[nReturnPos++] = ((nGroup-1) & 2) ? 'F' : '0';
-
-  // encode the status code
-  sReturn[nReturnPos++] = '0';
-  sReturn[nReturnPos++] = 'F';
-  sReturn[nReturnPos++] = 'F';
-  sReturn[nReturnPos++] = bStatus ? 'F' : '0';
-
-  sReturn[nReturnPos] = '\0';
-  return sReturn;
+  this->send( RCSwitch::codeWordA(sGroup, sDevice, false) );
 }
 
-/**
- * Encoding for the REV Switch Type
- *
- * The code word is a tristate word and with following bit pattern:
- *
- * +-----------------------------+-------------------+----------+--------------+
- * | 4 bits address              | 3 bits address    | 3 bits   | 2 bits       |
- * | switch group                | device number     | not used | on / off     |
- * | A=1FFF B=F1FF C=FF1F D=FFF1 | 1=0FF 2=F0F 3=FF0 | 000      | on=10 off=01 |
- * +-----------------------------+-------------------+----------+--------------+
- *
- * Source: http://www.the-intruder.net/funksteckdosen-von-rev-uber-arduino-ansteuern/
- *
- * @param sGroup        Name of the switch group (A..D, resp. a..d) 
- * @param nDevice       Number of the switch itself (1..3)
- * @param bStatus       Whether to switch on (true) or off (false)
- *
- * @return char[13], representing a tristate code word of length 12
- */
-char* RCSwitch::getCodeWordD(char sGroup, int nDevice, bool bStatus) {
-  static char sReturn[13];
-  int nReturnPos = 0;
-
-  // sGroup must be one of the letters in "abcdABCD"
-  int nGroup = (sGroup >= 'a') ? (int)sGroup - 'a' : (int)sGroup - 'A';
-  if ( nGroup < 0 || nGroup > 3 || nDevice < 1 || nDevice > 3) {
-    return 0;
-  }
-
-  for (int i = 0; i < 4; i++) {
-    sReturn[nReturnPos++] = (nGroup == i) ? '1' : 'F';
-  }
-
-  for (int i = 1; i <= 3; i++) {
-    sReturn[nReturnPos++] = (nDevice == i) ? '1' : 'F';
-  }
-
-  sReturn[nReturnPos++] = '0';
-  sReturn[nReturnPos++] = '0';
-  sReturn[nReturnPos++] = '0';
-
-  sReturn[nReturnPos++] = bStatus ? '1' : '0';
-  sReturn[nReturnPos++] = bStatus ? '0' : '1';
-
-  sReturn[nReturnPos] = '\0';
-  return sReturn;
-}
 
 /**
  * @param sCodeWord   a tristate code word consisting of the letter 0, 1, F
@@ -490,6 +406,15 @@ void RCSwitch::send(const char* sCodeWord) {
   this->send(code, length);
 }
 
+/**
+ * Send a code word built by one of the codeWordA..D() encoders.
+ */
+void RCSwitch::send(CodeWord codeWord) {
+  if (codeWord.length == 0)
+    return;
+  this->send(codeWord.code, codeWord.length);
+}
+
 /**
  * Transmit the first 'length' bits of the integer 'code'. The
  * bits are sent from MSB to LSB, i.e., first the bit at position length-1,
@@ -499,13 +424,7 @@ void RCSwitch::send(unsigned long code, unsigned int length) {
   if (this->nTransmitterPin == -1)
     return;
 
-#if not defined( RCSwitchDisableReceiving )
-  // make sure the receiver is disabled while we transmit
-  int nReceiverInterrupt_backup = nReceiverInterrupt;
-  if (nReceiverInterrupt_backup != -1) {
-    this->disableReceive();
-  }
-#endif
+  int nReceiverInterrupt_backup = this->pauseReceive();
 
   for (int nRepeat = 0; nRepeat < nRepeatTransmit; nRepeat++) {
     for (int i = length-1; i >= 0; i--) {
@@ -520,14 +439,166 @@ void RCSwitch::send(unsigned long code, unsigned int length) {
   // Disable transmit after sending (i.e., for inverted protocols)
   digitalWrite(this->nTransmitterPin, LOW);
 
+  this->resumeReceive(nReceiverInterrupt_backup);
+}
+
+/**
+ * Make sure the receiver is disabled while we transmit.
+ *
+ * @return the interrupt to pass to resumeReceive()
+ */
+int RCSwitch::pauseReceive() {
+#if not defined( RCSwitchDisableReceiving )
+  int nReceiverInterrupt_backup = nReceiverInterrupt;
+  if (nReceiverInterrupt_backup != -1) {
+    this->disableReceive();
+  }
+  return nReceiverInterrupt_backup;
+#else
+  return -1;
+#endif
+}
+
+/**
+ * Enable the receiver again if pauseReceive() just disabled it.
+ */
+void RCSwitch::resumeReceive(int nReceiverInterrupt_backup) {
 #if not defined( RCSwitchDisableReceiving )
-  // enable receiver again if we just disabled it
   if (nReceiverInterrupt_backup != -1) {
     this->enableReceive(nReceiverInterrupt_backup);
   }
+#if defined(RaspberryPi)
+  // line events keep being queued by the kernel while we transmit, so
+  // throw away whatever our own transmission produced
+  if (this->nReceiverFd != -1) {
+    uint8_t discard[256];
+    while (read(this->nReceiverFd, discard, sizeof(discard)) > 0) {
+    }
+    this->nLastEventTime = 0;
+    this->nEventStart = 0;
+    this->nEventEnd = 0;
+  }
+#endif
+#else
+  (void)nReceiverInterrupt_backup;
 #endif
 }
 
+/**
+ * Send several transmissions at the same time, e.g. on a 433MHz and a
+ * 315MHz transmitter, each with the protocol and repeat count of its
+ * sender. The edges of all of them are merged into one schedule, and each
+ * is written when its time relative to the common start has come, so the
+ * pulses of one pin are not stretched by the others and errors do not add
+ * up over the transmission.
+ *
+ * At most RCSWITCH_MAX_TRANSMITTERS transmissions are sent, any further
+ * ones and those of senders without a transmitter pin are ignored.
+ *
+ * @param simulate   if set, called for each edge instead of writing the
+ *                   pin, to check the schedule of each pin. Time is then
+ *                   virtual, see EdgeCallback
+ */
+void RCSwitch::sendConcurrent(const Transmission* transmissions, unsigned int nCount, EdgeCallback simulate) {
+  struct Stream {
+    unsigned int k;         // current pulse
+    unsigned int nPulses;
+    unsigned long next;     // time of the next edge
+    bool high;              // currently in the first half of pulse k
+    bool done;
+    int nReceiverInterrupt_backup;
+  };
+  Stream streams[RCSWITCH_MAX_TRANSMITTERS];
+  if (nCount > RCSWITCH_MAX_TRANSMITTERS) {
+    nCount = RCSWITCH_MAX_TRANSMITTERS;
+  }
+
+  for (unsigned int i = 0; i < nCount; i++) {
+    const Transmission &t = transmissions[i];
+    Stream &st = streams[i];
+    st.k = 0;
+    st.nPulses = (t.length + 1) * t.sender->nRepeatTransmit;
+    st.done = (st.nPulses == 0 || t.sender->nTransmitterPin == -1);
+    st.high = true;
+    st.nReceiverInterrupt_backup = st.done ? -1 : t.sender->pauseReceive();
+  }
+
+  const unsigned long start = micros();
+  // virtual time when simulating, advanced by the cost of each write
+  unsigned long now = 0;
+
+  for (unsigned int i = 0; i < nCount; i++) {
+    const Transmission &t = transmissions[i];
+    const Protocol &pro = t.sender->protocol;
+    Stream &st = streams[i];
+    if (st.done) {
+      continue;
+    }
+    const uint8_t level = (pro.invertedSignal) ? LOW : HIGH;
+    if (simulate) {
+      const unsigned long before = micros();
+      simulate(t.sender->nTransmitterPin, level, 0, now);
+      now += micros() - before;
+    } else {
+      digitalWrite(t.sender->nTransmitterPin, level);
+    }
+    st.next = (unsigned long)pro.pulseLength * pulseAt(pro, t.code, t.length, 0).high;
+  }
+
+  for (;;) {
+    // find the transmission with the earliest pending edge
+    int n = -1;
+    for (unsigned int i = 0; i < nCount; i++) {
+      if (!streams[i].done && (n == -1 || streams[i].next < streams[n].next)) {
+        n = i;
+      }
+    }
+    if (n == -1) {
+      break;
+    }
+
+    const Transmission &t = transmissions[n];
+    const Protocol &pro = t.sender->protocol;
+    Stream &st = streams[n];
+    const unsigned long due = st.next;
+    if (simulate) {
+      if (now < due) {
+        now = due;
+      }
+    } else {
+      while (micros() - start < due) {
+      }
+    }
+
+    uint8_t level;
+    if (st.high) {
+      level = (pro.invertedSignal) ? HIGH : LOW;
+      st.next += (unsigned long)pro.pulseLength * pulseAt(pro, t.code, t.length, st.k).low;
+      st.high = false;
+    } else if (++st.k < st.nPulses) {
+      level = (pro.invertedSignal) ? LOW : HIGH;
+      st.next += (unsigned long)pro.pulseLength * pulseAt(pro, t.code, t.length, st.k).high;
+      st.high = true;
+    } else {
+      // Disable transmit after sending (i.e., for inverted protocols)
+      level = LOW;
+      st.done = true;
+    }
+
+    if (simulate) {
+      const unsigned long before = micros();
+      simulate(t.sender->nTransmitterPin, level, due, now);
+      now += micros() - before;
+    } else {
+      digitalWrite(t.sender->nTransmitterPin, level);
+    }
+  }
+
+  for (unsigned int i = 0; i < nCount; i++) {
+    transmissions[i].sender->resumeReceive(streams[i].nReceiverInterrupt_backup);
+  }
+}
+
 /**
  * Transmit a single high-low pulse.
  */
@@ -541,6 +612,132 @@ void RCSwitch::transmit(HighLow pulses) {
   delayMicroseconds( this->protocol.pulseLength * pulses.low);
 }
 
+/**
+ * The k-th pulse of a transmission: each repetition consists of the
+ * 'length' data bits, MSB first, followed by the sync pulse.
+ */
+RCSwitch::HighLow RCSwitch::pulseAt(const Protocol& protocol, unsigned long code, unsigned int length, unsigned int k) {
+  const unsigned int i = k % (length + 1);
+  if (i == length) {
+    return protocol.syncFactor;
+  }
+  return (code & (1L << (length - 1 - i))) ? protocol.one : protocol.zero;
+}
+
+/* helper function for renderItems: append a level lasting duration
+ * microseconds as the next halves of the items. Levels longer than an item
+ * half can last are split across several halves. */
+static void appendLevel(RCSwitch::PulseItem* items, unsigned int nMaxItems, unsigned int* pnHalves,
+                        uint8_t level, unsigned long duration) {
+  while (duration > 0) {
+    const unsigned int chunk = (duration > 32767) ? 32767 : duration;
+    const unsigned int k = *pnHalves / 2;
+    if (items != 0 && k < nMaxItems) {
+      if (*pnHalves % 2 == 0) {
+        items[k].duration0 = chunk;
+        items[k].level0 = level;
+        // terminates the transmission unless another half follows
+        items[k].duration1 = 0;
+        items[k].level1 = LOW;
+      } else {
+        items[k].duration1 = chunk;
+        items[k].level1 = level;
+      }
+    }
+    (*pnHalves)++;
+    duration -= chunk;
+  }
+}
+
+/**
+ * Render what send(code, length) would transmit with the current protocol
+ * and repeat count as items for the ESP32 RMT peripheral, see PulseItem.
+ * Usually each pulse makes one item, but levels longer than 32767us, e.g.
+ * a long sync, are split across several.
+ *
+ * @param items       receives the items, may be 0 to query the size
+ * @param nMaxItems   capacity of items
+ * @return the number of items of the transmission, of which the first
+ *         nMaxItems were written
+ */
+unsigned int RCSwitch::renderItems(unsigned long code, unsigned int length, PulseItem* items, unsigned int nMaxItems) {
+  const unsigned int nPulses = (length + 1) * this->nRepeatTransmit;
+  const uint8_t firstLogicLevel = (this->protocol.invertedSignal) ? LOW : HIGH;
+  const uint8_t secondLogicLevel = (this->protocol.invertedSignal) ? HIGH : LOW;
+
+  unsigned int nHalves = 0;
+  for (unsigned int k = 0; k < nPulses; k++) {
+    const HighLow pulses = pulseAt(this->protocol, code, length, k);
+    appendLevel(items, nMaxItems, &nHalves, firstLogicLevel, (unsigned long)this->protocol.pulseLength * pulses.high);
+    appendLevel(items, nMaxItems, &nHalves, secondLogicLevel, (unsigned long)this->protocol.pulseLength * pulses.low);
+  }
+  return (nHalves + 1) / 2;
+}
+
+/* helper function for renderBitstream: set bits [from, to) of an MSB first
+ * bitstream to level */
+static void fillBits(uint8_t* buffer, unsigned long nBufferBits, unsigned long from, unsigned long to, bool level) {
+  if (to > nBufferBits) {
+    to = nBufferBits;
+  }
+  while (from < to && (from & 7) != 0) {
+    buffer[from >> 3] = level ? (buffer[from >> 3] | (0x80 >> (from & 7))) : (buffer[from >> 3] & ~(0x80 >> (from & 7)));
+    from++;
+  }
+  if (from < to && to - from >= 8) {
+    memset(&buffer[from >> 3], level ? 0xFF : 0x00, (to - from) >> 3);
+    from += (to - from) & ~7UL;
+  }
+  while (from < to) {
+    buffer[from >> 3] = level ? (buffer[from >> 3] | (0x80 >> (from & 7))) : (buffer[from >> 3] & ~(0x80 >> (from & 7)));
+    from++;
+  }
+}
+
+/**
+ * Render what send(code, length) would transmit with the current protocol
+ * and repeat count as a sampled bitstream, one bit per nResolution
+ * microseconds, most significant bit of each byte first. Shifted out at
+ * 1/nResolution MHz by an SPI or I2S peripheral through DMA, it reproduces
+ * the transmission without any CPU involvement; e.g. 100 kHz for a 10us
+ * resolution.
+ *
+ * Edges are placed at the sample nearest to their exact time, so the
+ * rounding errors of the single pulses do not add up. Afterwards the data
+ * line has to be left low, as send() does.
+ *
+ * @param nResolution   microseconds per bit
+ * @param buffer        receives the bitstream, may be 0 to query the size
+ * @param nBufferSize   capacity of buffer in bytes
+ * @return the number of bits of the transmission, of which the first
+ *         8*nBufferSize were written
+ */
+unsigned long RCSwitch::renderBitstream(unsigned long code, unsigned int length, unsigned int nResolution,
+                                        uint8_t* buffer, unsigned long nBufferSize) {
+  if (nResolution == 0) {
+    return 0;
+  }
+  const unsigned int nItems = (length + 1) * this->nRepeatTransmit;
+  const bool firstLogicLevel = !this->protocol.invertedSignal;
+  const unsigned long nBufferBits = (buffer != 0) ? 8 * nBufferSize : 0;
+
+  unsigned long time = 0;
+  unsigned long bit = 0;
+  for (unsigned int k = 0; k < nItems; k++) {
+    const HighLow pulses = pulseAt(this->protocol, code, length, k);
+
+    time += (unsigned long)this->protocol.pulseLength * pulses.high;
+    const unsigned long edge = (time + nResolution / 2) / nResolution;
+    fillBits(buffer, nBufferBits, bit, edge, firstLogicLevel);
+    bit = edge;
+
+    time += (unsigned long)this->protocol.pulseLength * pulses.low;
+    const unsigned long end = (time + nResolution / 2) / nResolution;
+    fillBits(buffer, nBufferBits, bit, end, !firstLogicLevel);
+    bit = end;
+  }
+  return bit;
+}
 
 #if not defined( RCSwitchDisableReceiving )
 /**
@@ -569,7 +766,13 @@ void RCSwitch::enableReceive() {
 void RCSwitch::disableReceive() {
 #if not defined(RaspberryPi) // Arduino
   detachInterrupt(this->nReceiverInterrupt);
-#endif // For Raspberry Pi (wiringPi) you can't unregister the ISR
+#else // For Raspberry Pi (wiringPi) you can't unregister the ISR
+  if (this->nReceiverFd != -1) {
+    close(this->nReceiverFd);
+    this->nReceiverFd = -1;
+  }
+  this->sampleState.rate = 0;
+#endif
   this->nReceiverInterrupt = -1;
 }
 
@@ -597,15 +800,351 @@ unsigned int RCSwitch::getReceivedProtocol() {
   return RCSwitch::nReceivedProtocol;
 }
 
-unsigned int* RCSwitch::getReceivedRawdata() {
+/**
+ * @return the timings of the last received frame, in units of
+ *         RCSWITCH_TIMING_TICK microseconds
+ */
+RCSwitch::Timing* RCSwitch::getReceivedRawdata() {
   return RCSwitch::timings;
 }
 
+/**
+ * @return ID of the device the last received code belongs to according to
+ *         the codebook, or RCSWITCH_NO_DEVICE
+ */
+unsigned int RCSwitch::getReceivedDevice() {
+  return RCSwitch::nReceivedDevice;
+}
+
+/**
+ * Set the codebook of known devices, which is used to resolve each received
+ * code to a device ID, see getReceivedDevice().
+ *
+ * If a code matches several entries, the one with the largest mask is
+ * used, e.g. an entry for one button of a remote before the entry for all
+ * of its buttons.
+ *
+ * The entries must be sorted as done by sortCodebook() and, like the
+ * protocol table, are read from PROGMEM on AVR. On ESP8266 and ESP32 they
+ * are read by the receive interrupt, which must not access flash, so the
+ * table has to be in RAM there. Declaring a pre-sorted table with
+ * RCSWITCH_CODEBOOK_ATTR puts it where it belongs on each platform:
+ *
+ *   const RCSwitch::CodebookEntry codebook[] RCSWITCH_CODEBOOK_ATTR = { ... };
+ *
+ * Tables in RAM can also be sorted at runtime instead.
+ *
+ * @param entries         sorted codebook, not copied
+ * @param nCount          number of entries
+ * @param bFilterUnknown  if true, codes not in the codebook are dropped and
+ *                        never become available()
+ */
+void RCSwitch::setCodebook(const CodebookEntry* entries, unsigned int nCount, bool bFilterUnknown) {
+  RCSwitch::codebook = entries;
+  RCSwitch::nCodebookSize = nCount;
+  RCSwitch::bCodebookFilter = bFilterUnknown;
+}
+
+/* helper function for sortCodebook and lookupCodebook, orders entries by
+ * protocol, bit length, mask (largest first) and code */
+static int RECEIVE_ATTR compareCodebookEntries(const RCSwitch::CodebookEntry* a, const RCSwitch::CodebookEntry* b) {
+  if (a->protocol != b->protocol) {
+    return (a->protocol < b->protocol) ? -1 : 1;
+  }
+  if (a->bitlength != b->bitlength) {
+    return (a->bitlength < b->bitlength) ? -1 : 1;
+  }
+  if (a->mask != b->mask) {
+    return (a->mask > b->mask) ? -1 : 1;
+  }
+  if (a->code != b->code) {
+    return (a->code < b->code) ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compareCodebookEntriesQsort(const void* a, const void* b) {
+  return compareCodebookEntries((const RCSwitch::CodebookEntry*)a, (const RCSwitch::CodebookEntry*)b);
+}
+
+/**
+ * Sort a codebook in place for use by setCodebook(). Bits of the codes
+ * outside their mask are cleared.
+ */
+void RCSwitch::sortCodebook(CodebookEntry* entries, unsigned int nCount) {
+  for (unsigned int i = 0; i < nCount; i++) {
+    entries[i].code &= entries[i].mask;
+  }
+  qsort(entries, nCount, sizeof(CodebookEntry), compareCodebookEntriesQsort);
+}
+
+/* helper function for lookupCodebook, the entries live where proto[] does */
+static inline void RECEIVE_ATTR readCodebookEntry(RCSwitch::CodebookEntry* dest, const RCSwitch::CodebookEntry* src) {
+#if defined(ESP8266) || defined(ESP32)
+  *dest = *src;
+#else
+  memcpy_P(dest, src, sizeof(*dest));
+#endif
+}
+
+/* helper function for lookupCodebook: index of the first entry not ordered
+ * before key */
+static unsigned int RECEIVE_ATTR lowerBound(const RCSwitch::CodebookEntry* entries, unsigned int lo, unsigned int hi,
+                                            const RCSwitch::CodebookEntry* key) {
+  while (lo < hi) {
+    const unsigned int mid = lo + (hi - lo) / 2;
+    RCSwitch::CodebookEntry entry;
+    readCodebookEntry(&entry, &entries[mid]);
+    if (compareCodebookEntries(&entry, key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Resolve a code to a device ID using the codebook. Entries are grouped by
+ * protocol, bit length and mask; each group is searched with a binary
+ * search, so a lookup takes log2(entries) steps per distinct mask.
+ *
+ * Groups are searched from the largest mask down and the first match is
+ * returned, so the more specific of two nested masks takes precedence.
+ *
+ * @return ID of the matching device, or RCSWITCH_NO_DEVICE
+ */
+unsigned int RECEIVE_ATTR RCSwitch::lookupCodebook(unsigned int nProtocol, unsigned int nBitlength, unsigned long code) {
+  const CodebookEntry* entries = RCSwitch::codebook;
+  const unsigned int n = RCSwitch::nCodebookSize;
+
+  CodebookEntry key;
+  key.protocol = nProtocol;
+  key.bitlength = nBitlength;
+  key.mask = 0xFFFFFFFFUL;
+  key.code = 0;
+  unsigned int i = lowerBound(entries, 0, n, &key);
+
+  while (i < n) {
+    CodebookEntry entry;
+    readCodebookEntry(&entry, &entries[i]);
+    if (entry.protocol != nProtocol || entry.bitlength != nBitlength) {
+      break;
+    }
+
+    // search the group of entries sharing this mask
+    key.mask = entry.mask;
+    key.code = code & entry.mask;
+    const unsigned int match = lowerBound(entries, i, n, &key);
+    if (match < n) {
+      readCodebookEntry(&entry, &entries[match]);
+      if (compareCodebookEntries(&entry, &key) == 0) {
+        return entry.device;
+      }
+    }
+
+    // continue with the next mask
+    if (key.mask == 0) {
+      break;
+    }
+    key.mask--;
+    key.code = 0;
+    i = lowerBound(entries, match, n, &key);
+  }
+
+  return RCSWITCH_NO_DEVICE;
+}
+
+/**
+ * Set the hold and release timeouts of all protocols, see availableEvent().
+ *
+ * @param nHoldTimeout     milliseconds a frame has to keep repeating for
+ *                         EVENT_HOLD, default 500
+ * @param nReleaseTimeout  milliseconds without repetition for EVENT_RELEASE,
+ *                         default 250. Must exceed the time the decoder
+ *                         needs per frame, i.e. two repetitions.
+ */
+void RCSwitch::setEventTimeouts(unsigned int nHoldTimeout, unsigned int nReleaseTimeout) {
+  RECEIVE_LOCK();
+  nDefaultHoldTimeout = nHoldTimeout;
+  nDefaultReleaseTimeout = nReleaseTimeout;
+  for (unsigned int i = 0; i < numProto; i++) {
+    holdTimeouts[i] = 0;
+    releaseTimeouts[i] = 0;
+  }
+  RCSwitch::eventRecorder = recordEvent;
+  RECEIVE_UNLOCK();
+}
+
+/**
+ * Set the hold and release timeouts of a single protocol, e.g. of one with
+ * long frames.
+ */
+void RCSwitch::setEventTimeouts(int nProtocol, unsigned int nHoldTimeout, unsigned int nReleaseTimeout) {
+  if (nProtocol < 1 || nProtocol > numProto) {
+    return;
+  }
+  RECEIVE_LOCK();
+  holdTimeouts[nProtocol-1] = nHoldTimeout;
+  releaseTimeouts[nProtocol-1] = nReleaseTimeout;
+  RCSwitch::eventRecorder = recordEvent;
+  RECEIVE_UNLOCK();
+}
+
+/* helper functions for the events */
+static inline unsigned int RECEIVE_ATTR holdTimeout(unsigned int p) {
+  return (holdTimeouts[p-1] != 0) ? holdTimeouts[p-1] : nDefaultHoldTimeout;
+}
+
+static inline unsigned int RECEIVE_ATTR releaseTimeout(unsigned int p) {
+  return (releaseTimeouts[p-1] != 0) ? releaseTimeouts[p-1] : nDefaultReleaseTimeout;
+}
+
+/**
+ * Queue the press in progress with the given state. If the sketch does not
+ * keep up, the oldest event is dropped.
+ */
+void RECEIVE_ATTR RCSwitch::pushEvent(EventState state) {
+  RCSwitch::currentEvent.state = state;
+  RCSwitch::events[(RCSwitch::nEventTail + RCSwitch::nEventCount) % RCSWITCH_MAX_EVENTS] = RCSwitch::currentEvent;
+  if (RCSwitch::nEventCount == RCSWITCH_MAX_EVENTS) {
+    RCSwitch::nEventTail = (RCSwitch::nEventTail + 1) % RCSWITCH_MAX_EVENTS;
+  } else {
+    RCSwitch::nEventCount = RCSwitch::nEventCount + 1;
+  }
+}
+
+/**
+ * Aggregate the frame just received into the press in progress. Called by
+ * the decoder with the receive lock held, once the event API is in use.
+ */
+void RECEIVE_ATTR RCSwitch::recordEvent(const int p) {
+  const unsigned long now = millis();
+  Event &ev = RCSwitch::currentEvent;
+
+  if (RCSwitch::bEventActive && ev.value == RCSwitch::nReceivedValue &&
+      ev.bitlength == RCSwitch::nReceivedBitlength && ev.protocol == (unsigned int)p &&
+      now - RCSwitch::nLastSeen <= releaseTimeout(p)) {
+    // the button is still pressed
+    ev.repeatCount++;
+    RCSwitch::nLastSeen = now;
+    if (ev.state == EVENT_PRESS && now - ev.firstSeen >= holdTimeout(p)) {
+      pushEvent(EVENT_HOLD);
+    }
+  } else {
+    if (RCSwitch::bEventActive) {
+      pushEvent(EVENT_RELEASE);
+    }
+    ev.value = RCSwitch::nReceivedValue;
+    ev.bitlength = RCSwitch::nReceivedBitlength;
+    ev.protocol = p;
+    ev.device = RCSwitch::nReceivedDevice;
+    ev.firstSeen = now;
+    ev.repeatCount = 1;
+    RCSwitch::nLastSeen = now;
+    RCSwitch::bEventActive = true;
+    pushEvent(EVENT_PRESS);
+  }
+}
+
+/**
+ * Whether an event is waiting, see getEvent(). Unlike available(), one
+ * button press results in one EVENT_PRESS, at most one EVENT_HOLD and one
+ * EVENT_RELEASE, no matter how many frames the remote sends.
+ *
+ * Release is detected by the lack of frames, so this has to be called
+ * regularly to report it in time.
+ *
+ * Frames are only aggregated into events once this or setEventTimeouts()
+ * has been called. Sketches which use neither do not pay for events, the
+ * linker drops their code and RAM.
+ */
+bool RCSwitch::availableEvent() {
+  RECEIVE_LOCK();
+  RCSwitch::eventRecorder = recordEvent;
+  if (RCSwitch::bEventActive &&
+      millis() - RCSwitch::nLastSeen > releaseTimeout(RCSwitch::currentEvent.protocol)) {
+    RCSwitch::bEventActive = false;
+    pushEvent(EVENT_RELEASE);
+  }
+  const bool bAvailable = RCSwitch::nEventCount != 0;
+  RECEIVE_UNLOCK();
+  return bAvailable;
+}
+
+/**
+ * @return the oldest waiting event
+ */
+RCSwitch::Event RCSwitch::getEvent() {
+  RECEIVE_LOCK();
+  const Event ev = RCSwitch::events[RCSwitch::nEventTail];
+  RECEIVE_UNLOCK();
+  return ev;
+}
+
+/**
+ * Drop the oldest waiting event, making the next one available.
+ */
+void RCSwitch::resetAvailableEvent() {
+  RECEIVE_LOCK();
+  if (RCSwitch::nEventCount != 0) {
+    RCSwitch::nEventTail = (RCSwitch::nEventTail + 1) % RCSWITCH_MAX_EVENTS;
+    RCSwitch::nEventCount = RCSwitch::nEventCount - 1;
+  }
+  RECEIVE_UNLOCK();
+}
+
+#if defined(RaspberryPi)
+/**
+ * Map a codebook file into memory, for use by setCodebook(). The file is
+ * the raw array of CodebookEntry structs as sorted by sortCodebook().
+ *
+ * @return the entries, or NULL on error
+ */
+const RCSwitch::CodebookEntry* RCSwitch::mapCodebook(const char* sPath, unsigned int* pnCount) {
+  const int fd = open(sPath, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0 || st.st_size % sizeof(CodebookEntry) != 0) {
+    close(fd);
+    return NULL;
+  }
+  void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  *pnCount = st.st_size / sizeof(CodebookEntry);
+  return (const CodebookEntry*)p;
+}
+#endif
+
 /* helper function for the receiveProtocol method */
 static inline unsigned int diff(int A, int B) {
   return abs(A - B);
 }
 
+/**
+ * Store a duration in microseconds as a timing, see RCSWITCH_COMPACT_TIMINGS.
+ */
+inline RCSwitch::Timing RECEIVE_ATTR RCSwitch::quantizeTiming(unsigned int duration) {
+#if defined( RCSWITCH_COMPACT_TIMINGS )
+  return (duration >= (unsigned long)RCSWITCH_TIMING_MAX * RCSWITCH_TIMING_TICK) ? RCSWITCH_TIMING_MAX :
+         (duration + RCSWITCH_TIMING_TICK / 2) / RCSWITCH_TIMING_TICK;
+#else
+  return duration;
+#endif
+}
+
+/**
+ * @return the i-th stored timing in microseconds
+ */
+inline unsigned int RECEIVE_ATTR RCSwitch::timingAt(unsigned int i) {
+  return (unsigned int)RCSwitch::timings[i] * RCSWITCH_TIMING_TICK;
+}
+
 /**
  *
  */
@@ -620,7 +1159,7 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
     unsigned long code = 0;
     //Assuming the longer pulse length is the pulse captured in timings[0]
     const unsigned int syncLengthInPulses =  ((pro.syncFactor.low) > (pro.syncFactor.high)) ? (pro.syncFactor.low) : (pro.syncFactor.high);
-    const unsigned int delay = RCSwitch::timings[0] / syncLengthInPulses;
+    const unsigned int delay = timingAt(0) / syncLengthInPulses;
     const unsigned int delayTolerance = delay * RCSwitch::nReceiveTolerance / 100;
     
     /* For protocols that start low, the sync period looks like
@@ -644,11 +1183,11 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
 
     for (unsigned int i = firstDataTiming; i < changeCount - 1; i += 2) {
         code <<= 1;
-        if (diff(RCSwitch::timings[i], delay * pro.zero.high) < delayTolerance &&
-            diff(RCSwitch::timings[i + 1], delay * pro.zero.low) < delayTolerance) {
+        if (diff(timingAt(i), delay * pro.zero.high) < delayTolerance &&
+            diff(timingAt(i + 1), delay * pro.zero.low) < delayTolerance) {
             // zero
-        } else if (diff(RCSwitch::timings[i], delay * pro.one.high) < delayTolerance &&
-                   diff(RCSwitch::timings[i + 1], delay * pro.one.low) < delayTolerance) {
+        } else if (diff(timingAt(i), delay * pro.one.high) < delayTolerance &&
+                   diff(timingAt(i + 1), delay * pro.one.low) < delayTolerance) {
             // one
             code |= 1;
         } else {
@@ -658,10 +1197,22 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
     }
 
     if (changeCount > 7) {    // ignore very short transmissions: no device sends them, so this must be noise
+        const unsigned int bitlength = (changeCount - 1) / 2;
+        const unsigned int device = RCSwitch::lookupCodebook(p, bitlength, code);
+        if (device == RCSWITCH_NO_DEVICE && RCSwitch::bCodebookFilter) {
+            // decoded fine, but not one of ours
+            return true;
+        }
+        RCSwitch::nReceivedDevice = device;
         RCSwitch::nReceivedValue = code;
-        RCSwitch::nReceivedBitlength = (changeCount - 1) / 2;
+        RCSwitch::nReceivedBitlength = bitlength;
         RCSwitch::nReceivedDelay = delay;
         RCSwitch::nReceivedProtocol = p;
+        RECEIVE_ISR_LOCK();
+        if (RCSwitch::eventRecorder) {
+          RCSwitch::eventRecorder(p);
+        }
+        RECEIVE_ISR_UNLOCK();
         return true;
     }
 
@@ -670,17 +1221,28 @@ bool RECEIVE_ATTR RCSwitch::receiveProtocol(const int p, unsigned int changeCoun
 
 void RECEIVE_ATTR RCSwitch::handleInterrupt() {
 
-  static unsigned int changeCount = 0;
   static unsigned long lastTime = 0;
-  static unsigned int repeatCount = 0;
 
   const long time = micros();
   const unsigned int duration = time - lastTime;
+  lastTime = time;
+
+  RCSwitch::handleTiming(duration);
+}
+
+/**
+ * Feed the duration of one signal level (i.e. the time between two
+ * consecutive level changes) in microseconds into the decoder.
+ */
+void RECEIVE_ATTR RCSwitch::handleTiming(unsigned int duration) {
+
+  static unsigned int changeCount = 0;
+  static unsigned int repeatCount = 0;
 
   if (duration > RCSwitch::nSeparationLimit) {
     // A long stretch without signal level change occurred. This could
     // be the gap between two transmission.
-    if ((repeatCount==0) || (diff(duration, RCSwitch::timings[0]) < 200)) {
+    if ((repeatCount==0) || (diff(duration, timingAt(0)) < 200 + RCSWITCH_TIMING_TICK / 2)) {
       // This long signal is close in length to the long signal which
       // started the previously recorded timings; this suggests that
       // it may indeed by a a gap between two transmissions (we assume
@@ -706,7 +1268,290 @@ void RECEIVE_ATTR RCSwitch::handleInterrupt() {
     repeatCount = 0;
   }
 
-  RCSwitch::timings[changeCount++] = duration;
-  lastTime = time;  
+  RCSwitch::timings[changeCount++] = quantizeTiming(duration);
+}
+
+#if defined(RaspberryPi)
+/**
+ * Enable receiving through the GPIO character device of the Linux kernel.
+ *
+ * Unlike wiringPi interrupts, edges are timestamped by the kernel when they
+ * happen and queued until handleEvents() is called, so neither the timing
+ * nor the CPU usage depend on how quickly user space wakes up.
+ *
+ * @param sChip   GPIO chip device, e.g. "/dev/gpiochip0"
+ * @param nLine   line offset on that chip, i.e. the BCM pin number on a Pi
+ * @return false if the line could not be requested
+ */
+bool RCSwitch::enableReceive(const char* sChip, unsigned int nLine) {
+  const int chip = open(sChip, O_RDONLY | O_CLOEXEC);
+  if (chip < 0) {
+    return false;
+  }
+
+  struct gpioevent_request req;
+  memset(&req, 0, sizeof(req));
+  req.lineoffset = nLine;
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+  strncpy(req.consumer_label, "rc-switch", sizeof(req.consumer_label) - 1);
+
+  const int ret = ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req);
+  close(chip);
+  if (ret < 0) {
+    return false;
+  }
+
+  this->enableReceiveFd(req.fd);
+  return true;
+}
+
+/**
+ * Enable receiving from a descriptor delivering struct gpioevent_data
+ * records, e.g. a line event descriptor or a pipe fed with recorded events.
+ * The descriptor is switched to non-blocking mode and closed by
+ * disableReceive().
+ */
+void RCSwitch::enableReceiveFd(int fd) {
+  this->disableReceive();
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  this->nReceiverFd = fd;
+  this->nLastEventTime = 0;
+  this->nEventStart = 0;
+  this->nEventEnd = 0;
+  RCSwitch::nReceivedValue = 0;
+  RCSwitch::nReceivedBitlength = 0;
 }
+
+/**
+ * @return the descriptor to poll() for pending edges, or -1
+ */
+int RCSwitch::getReceiveFd() {
+  return this->nReceiverFd;
+}
+
+/**
+ * Decode the edges queued on the receive descriptor, without blocking,
+ * until a frame becomes available() or no edges are left. The edges read
+ * after the frame are kept for the next call, so calling this again after
+ * resetAvailable() gets every frame even if several were queued.
+ *
+ * @return number of edges handled, -1 on error or end of stream
+ */
+int RCSwitch::handleEvents() {
+  if (this->nReceiverFd == -1) {
+    return -1;
+  }
+
+  const size_t nEventSize = sizeof(struct gpioevent_data);
+  static_assert(sizeof(this->eventBuffer) % sizeof(struct gpioevent_data) == 0, "unexpected gpioevent_data size");
+
+  const bool bWasAvailable = this->available();
+  int nHandled = 0;
+  for (;;) {
+    while (this->nEventEnd - this->nEventStart >= nEventSize) {
+      struct gpioevent_data event;
+      memcpy(&event, this->eventBuffer + this->nEventStart, nEventSize);
+      this->nEventStart += nEventSize;
+      nHandled++;
+
+      if (this->nLastEventTime != 0) {
+        const uint64_t duration = (event.timestamp - this->nLastEventTime) / 1000;
+        RCSwitch::handleTiming((duration > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : (unsigned int)duration);
+      }
+      this->nLastEventTime = event.timestamp;
+
+      if (!bWasAvailable && this->available()) {
+        return nHandled;
+      }
+    }
+
+    // keep a partially read event and fill up the buffer behind it
+    const unsigned int nRest = this->nEventEnd - this->nEventStart;
+    memmove(this->eventBuffer, this->eventBuffer + this->nEventStart, nRest);
+    this->nEventStart = 0;
+    this->nEventEnd = nRest;
+
+    const ssize_t n = read(this->nReceiverFd, this->eventBuffer + nRest, sizeof(this->eventBuffer) - nRest);
+    if (n < 0) {
+      return (errno == EAGAIN || errno == EINTR) ? nHandled : -1;
+    }
+    if (n == 0) {
+      return (nHandled > 0) ? nHandled : -1;
+    }
+    this->nEventEnd += n;
+  }
+}
+
+/**
+ * Enable receiving from a stream of raw receiver samples instead of a GPIO,
+ * e.g. the output of rtl_sdr or of an ADC sampling the data pin of an OOK
+ * receiver module.
+ *
+ * Like the other descriptor based receive paths this is only built for
+ * Linux with wiringPi, i.e. with -DRPI.
+ *
+ * @param nSampleRate   samples per second (per I/Q pair if bIQ is set)
+ * @param bIQ           true for interleaved unsigned 8 bit I/Q pairs (rtl_sdr
+ *                      format), false for unsigned 8 bit amplitudes
+ * @return false if the sample rate is 0
+ */
+bool RCSwitch::enableReceiveSamples(unsigned long nSampleRate, bool bIQ) {
+  SampleState &st = this->sampleState;
+  if (nSampleRate == 0) {
+    st.rate = 0;
+    return false;
+  }
+  st.rate = nSampleRate;
+  st.iq = bIQ;
+  st.pending = -1;
+
+  // smooth the envelope over ~2us, which still resolves the shortest
+  // pulses of the known protocols (4*100us for protocol 3)
+  st.smoothShift = 0;
+  while ((nSampleRate >> st.smoothShift) > 500000) {
+    st.smoothShift++;
+  }
+  // follow peak and noise floor over ~30ms, so neither moves much
+  // during the long low part of a sync pulse
+  st.trackShift = 0;
+  while ((nSampleRate >> st.trackShift) > 32) {
+    st.trackShift++;
+  }
+
+  st.envelope = 0;
+  st.peak = 0;
+  st.floor = 0;
+  st.level = false;
+  st.run = 0;
+  st.microsPerSample = (unsigned long)((1000000ULL << 16) / nSampleRate);
+
+  RCSwitch::nReceivedValue = 0;
+  RCSwitch::nReceivedBitlength = 0;
+  return true;
+}
+
+/* helper function for handleSamples: magnitude estimate max + min/2 of |I|
+ * and |Q|, both scaled by 2 around the 127.5 offset, for n I/Q pairs.
+ *
+ * The loop has no dependencies between samples, but GCC only vectorises
+ * it with more than the very cheap cost model of -O2, and neither abs()
+ * nor an unsigned max() on plain x86-64. So it asks for vectorisation
+ * itself, and computes |x| as the larger of x and -x, all of it signed. */
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((optimize("tree-vectorize")))
+#endif
+static void iqMagnitudes(const uint8_t* samples, uint16_t* mag, size_t n) {
+  for (size_t k = 0; k < n; k++) {
+    const int16_t i = 2 * samples[2 * k] - 255;
+    const int16_t q = 2 * samples[2 * k + 1] - 255;
+    const int16_t ni = 255 - 2 * samples[2 * k];
+    const int16_t nq = 255 - 2 * samples[2 * k + 1];
+    const int16_t ai = (i > ni) ? i : ni;
+    const int16_t aq = (q > nq) ? q : nq;
+    const int16_t hi = (ai > aq) ? ai : aq;
+    const int16_t lo = (ai > aq) ? aq : ai;
+    mag[k] = hi + (lo >> 1);
+  }
+}
+
+/**
+ * Slice a block of raw samples into signal levels and feed the resulting
+ * timings into the decoder. Blocks may have any size, an I/Q pair split
+ * between two calls is handled.
+ */
+void RCSwitch::handleSamples(const uint8_t* samples, size_t nCount) {
+  SampleState &st = this->sampleState;
+  if (st.rate == 0) {
+    return;
+  }
+
+  if (st.iq && st.pending >= 0 && nCount > 0) {
+    const uint8_t pair[2] = { (uint8_t)st.pending, samples[0] };
+    st.pending = -1;
+    this->handleSamples(pair, 2);
+    samples++;
+    nCount--;
+  }
+
+  const size_t nBlock = 256;
+  uint16_t mag[nBlock];
+
+  while (nCount > 0) {
+    size_t n;
+    if (st.iq) {
+      if (nCount == 1) {
+        st.pending = samples[0];
+        return;
+      }
+      n = (nCount / 2 < nBlock) ? nCount / 2 : nBlock;
+      iqMagnitudes(samples, mag, n);
+      samples += 2 * n;
+      nCount -= 2 * n;
+    } else {
+      n = (nCount < nBlock) ? nCount : nBlock;
+      for (size_t k = 0; k < n; k++) {
+        mag[k] = samples[k];
+      }
+      samples += n;
+      nCount -= n;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      st.envelope += (((int32_t)mag[k] << 4) - st.envelope) >> st.smoothShift;
+
+      // the trackers move by a tiny fraction of the difference per
+      // sample, which only adds up with their 16 fractional bits
+      const int32_t envelope = st.envelope << 16;
+      if (envelope > st.peak) {
+        st.peak = envelope;
+      } else {
+        st.peak -= (st.peak - envelope) >> st.trackShift;
+      }
+      if (envelope < st.floor) {
+        st.floor = envelope;
+      } else {
+        st.floor += (envelope - st.floor) >> st.trackShift;
+      }
+
+      const int32_t span = (st.peak - st.floor) >> 16;
+      const int32_t threshold = (st.floor >> 16) + span / 2;
+      const int32_t hysteresis = span / 8;
+      bool level = st.level;
+      if (span < (8 << 4)) {
+        // not enough contrast to tell a carrier from noise
+        level = false;
+      } else if (st.envelope > threshold + hysteresis) {
+        level = true;
+      } else if (st.envelope < threshold - hysteresis) {
+        level = false;
+      }
+
+      if (level != st.level) {
+        RCSwitch::handleTiming((unsigned int)(((unsigned long long)st.run * st.microsPerSample) >> 16));
+        st.level = level;
+        st.run = 0;
+      }
+      // saturate at about one second, which is a gap for any protocol
+      if (st.run < st.rate) {
+        st.run++;
+      }
+    }
+  }
+}
+
+/**
+ * Read the next chunk of raw samples from a file or pipe and decode it.
+ *
+ * @return number of bytes consumed, 0 at end of file, -1 on error
+ */
+int RCSwitch::handleSamples(int fd) {
+  uint8_t buffer[16384];
+  const ssize_t n = read(fd, buffer, sizeof(buffer));
+  if (n > 0) {
+    this->handleSamples(buffer, (size_t)n);
+  }
+  return (int)n;
+}
+#endif
 #endif
@@ -40,6 +40,7 @@
     // Include libraries for RPi:
     #include <string.h> /* memcpy */
     #include <stdlib.h> /* abs */
+    #include <stddef.h> /* size_t */
     #include <wiringPi.h>
 #elif defined(SPARK)
     #include "application.h"
@@ -48,6 +49,7 @@
 #endif
 
 #include <stdint.h>
+#include <limits.h>
 
 
 // At least for the ATTiny X4/X5, receiving has to be disabled due to
@@ -58,7 +60,81 @@
 
 // Number of maximum high/Low changes per packet.
 // We can handle up to (unsigned long) => 32 bit * 2 H/L changes per bit + 2 for sync
+//
+// This and the other RCSWITCH_ options below size the receiver state, so
+// they have to be set for the whole build, not by a #define in a sketch.
+#ifndef RCSWITCH_MAX_CHANGES
 #define RCSWITCH_MAX_CHANGES 67
+#endif
+#if defined( __SIZEOF_LONG__ ) && __SIZEOF_LONG__ == 8
+  #if RCSWITCH_MAX_CHANGES > 131
+    #error "RCSWITCH_MAX_CHANGES must be at most 131, more bits than an unsigned long holds cannot be decoded"
+  #endif
+#elif RCSWITCH_MAX_CHANGES > 67
+  #error "RCSWITCH_MAX_CHANGES must be at most 67, more bits than an unsigned long holds cannot be decoded"
+#endif
+
+// Storage of the received timings. By default each is an unsigned int of
+// microseconds. Define RCSWITCH_COMPACT_TIMINGS as 8 or 16 to store them
+// in that many bits instead, counting ticks of RCSWITCH_TIMING_TICK
+// microseconds and saturating at the largest value.
+//
+// 8 bit timings with the default tick of 64us halve the buffer on AVR and
+// reach up to 16320us, which is enough for the sync of all protocols but
+// 8 and 9. 16 bit timings with the default tick of 1us halve the buffer on
+// ESP and ARM and reach up to 65535us, like an unsigned int on AVR. The
+// largest timing in microseconds has to fit an unsigned int, which is checked
+// below.
+#if !defined( RCSWITCH_COMPACT_TIMINGS )
+  #define RCSWITCH_TIMING_TYPE unsigned int
+  #undef RCSWITCH_TIMING_TICK
+  #define RCSWITCH_TIMING_TICK 1
+#elif RCSWITCH_COMPACT_TIMINGS == 8
+  #define RCSWITCH_TIMING_TYPE uint8_t
+  #define RCSWITCH_TIMING_MAX 0xFFU
+  #ifndef RCSWITCH_TIMING_TICK
+  #define RCSWITCH_TIMING_TICK 64
+  #endif
+#elif RCSWITCH_COMPACT_TIMINGS == 16
+  #define RCSWITCH_TIMING_TYPE uint16_t
+  #define RCSWITCH_TIMING_MAX 0xFFFFU
+  #ifndef RCSWITCH_TIMING_TICK
+  #define RCSWITCH_TIMING_TICK 1
+  #endif
+#else
+  #error "RCSWITCH_COMPACT_TIMINGS must be 8 or 16"
+#endif
+#if RCSWITCH_TIMING_TICK < 1
+  #error "RCSWITCH_TIMING_TICK must be at least 1"
+#endif
+#if defined( RCSWITCH_TIMING_MAX ) && RCSWITCH_TIMING_MAX * RCSWITCH_TIMING_TICK > UINT_MAX
+  #error "RCSWITCH_TIMING_MAX * RCSWITCH_TIMING_TICK microseconds must fit an unsigned int"
+#endif
+
+// Device ID reported for codes which are not in the codebook
+#define RCSWITCH_NO_DEVICE 0xFFFF
+
+// Where to put a codebook table, see setCodebook(). Like the protocol
+// table it is in flash on AVR, but on ESP it is read by the receive
+// interrupt, which must not touch flash, so it has to stay in RAM.
+#if defined(ESP32)
+  #define RCSWITCH_CODEBOOK_ATTR DRAM_ATTR
+#elif defined(ESP8266) || defined(RaspberryPi)
+  #define RCSWITCH_CODEBOOK_ATTR
+#else
+  #define RCSWITCH_CODEBOOK_ATTR PROGMEM
+#endif
+
+// Number of press/hold/release events queued until the sketch fetches them
+#ifndef RCSWITCH_MAX_EVENTS
+#define RCSWITCH_MAX_EVENTS 4
+#endif
+#if RCSWITCH_MAX_EVENTS < 1 || RCSWITCH_MAX_EVENTS > 255
+  #error "RCSWITCH_MAX_EVENTS must be 1..255"
+#endif
+
+// Number of transmitters sendConcurrent() can drive at the same time
+#define RCSWITCH_MAX_TRANSMITTERS 4
 
 class RCSwitch {
 
@@ -76,9 +152,104 @@ class RCSwitch {
     void switchOn(char sGroup, int nDevice);
     void switchOff(char sGroup, int nDevice);
 
+    /**
+     * A code word ready to be sent, i.e. the arguments of send(code, length).
+     * A length of 0 marks invalid arguments to one of the encoders below,
+     * nothing is sent for it.
+     */
+    struct CodeWord {
+        unsigned long code;
+        unsigned int length;
+    };
+
     void sendTriState(const char* sCodeWord);
     void send(unsigned long code, unsigned int length);
     void send(const char* sCodeWord);
+    void send(CodeWord codeWord);
+
+    /**
+     * Encoders for the switch types, which turn the settings of a switch
+     * directly into the bits of its tristate code word (0 = 00, F = 01,
+     * 1 = 11). As they are constexpr, the codes of fixed devices can be
+     * computed at compile time:
+     *
+     *   constexpr RCSwitch::CodeWord kitchenOn = RCSwitch::codeWordB(1, 2, true);
+     *   mySwitch.send(kitchenOn);
+     */
+
+    /**
+     * Type A with 10 pole DIP switches
+     *
+     * @param sGroup        Code of the switch group (refers to DIP switches 1..5 where "1" = on and "0" = off, if all DIP switches are on it's "11111")
+     * @param sDevice       Code of the switch device (refers to DIP switches 6..10 (A..E) where "1" = on and "0" = off, if all DIP switches are on it's "11111")
+     * @param bStatus       Whether to switch on (true) or off (false)
+     */
+    static constexpr CodeWord codeWordA(const char* sGroup, const char* sDevice, bool bStatus) {
+        return CodeWord{ (dipSwitchTristate(sGroup, 5, 0) << 14) |
+                         (dipSwitchTristate(sDevice, 5, 0) << 4) |
+                         (bStatus ? 0x1UL : 0x4UL), 24 };
+    }
+
+    /**
+     * Type B with two rotary/sliding switches
+     *
+     * The code word is a tristate word and with following bit pattern:
+     *
+     * +-----------------------------+-----------------------------+----------+------------+
+     * | 4 bits address              | 4 bits address              | 3 bits   | 1 bit      |
+     * | switch group                | switch number               | not used | on / off   |
+     * | 1=0FFF 2=F0FF 3=FF0F 4=FFF0 | 1=0FFF 2=F0FF 3=FF0F 4=FFF0 | FFF      | on=F off=0 |
+     * +-----------------------------+-----------------------------+----------+------------+
+     *
+     * @param nAddressCode  Number of the switch group (1..4)
+     * @param nChannelCode  Number of the switch itself (1..4)
+     * @param bStatus       Whether to switch on (true) or off (false)
+     */
+    static constexpr CodeWord codeWordB(int nAddressCode, int nChannelCode, bool bStatus) {
+        return (nAddressCode < 1 || nAddressCode > 4 || nChannelCode < 1 || nChannelCode > 4) ? CodeWord{ 0, 0 } :
+               CodeWord{ ((0x55UL & ~(3UL << (2 * (4 - nAddressCode)))) << 16) |
+                         ((0x55UL & ~(3UL << (2 * (4 - nChannelCode)))) << 8) |
+                         (0x15UL << 2) |
+                         (bStatus ? 0x1UL : 0x0UL), 24 };
+    }
+
+    /**
+     * Type C Intertechno
+     *
+     * @param sFamily  Familycode (a..p)
+     * @param nGroup   Number of group (1..4)
+     * @param nDevice  Number of device (1..4)
+     * @param bStatus  Whether to switch on (true) or off (false)
+     */
+    static constexpr CodeWord codeWordC(char sFamily, int nGroup, int nDevice, bool bStatus) {
+        return (sFamily < 'a' || sFamily > 'p' || nGroup < 1 || nGroup > 4 || nDevice < 1 || nDevice > 4) ? CodeWord{ 0, 0 } :
+               CodeWord{ (bitsTristate(sFamily - 'a', 4, 0) << 16) |
+                         (bitsTristate(nDevice - 1, 2, 0) << 12) |
+                         (bitsTristate(nGroup - 1, 2, 0) << 8) |
+                         0x14UL |
+                         (bStatus ? 0x1UL : 0x0UL), 24 };
+    }
+
+    /**
+     * Type D REV
+     *
+     * The code word is a tristate word and with following bit pattern:
+     *
+     * +-----------------------------+-------------------+----------+--------------+
+     * | 4 bits address              | 3 bits address    | 3 bits   | 2 bits       |
+     * | switch group                | device number     | not used | on / off     |
+     * | A=1FFF B=F1FF C=FF1F D=FFF1 | 1=0FF 2=F0F 3=FF0 | 000      | on=10 off=01 |
+     * +-----------------------------+-------------------+----------+--------------+
+     *
+     * Source: http://www.the-intruder.net/funksteckdosen-von-rev-uber-arduino-ansteuern/
+     *
+     * @param sGroup        Name of the switch group (A..D, resp. a..d)
+     * @param nDevice       Number of the switch itself (1..3)
+     * @param bStatus       Whether to switch on (true) or off (false)
+     */
+    static constexpr CodeWord codeWordD(char sGroup, int nDevice, bool bStatus) {
+        return codeWordDIndex((sGroup >= 'a') ? sGroup - 'a' : sGroup - 'A', nDevice, bStatus);
+    }
     
     #if not defined( RCSwitchDisableReceiving )
     void enableReceive(int interrupt);
@@ -91,7 +262,58 @@ class RCSwitch {
     unsigned int getReceivedBitlength();
     unsigned int getReceivedDelay();
     unsigned int getReceivedProtocol();
-    unsigned int* getReceivedRawdata();
+    /**
+     * A received timing, in units of RCSWITCH_TIMING_TICK microseconds.
+     */
+    typedef RCSWITCH_TIMING_TYPE Timing;
+
+    Timing* getReceivedRawdata();
+    unsigned int getReceivedDevice();
+
+    /**
+     * Pressing a button makes a remote repeat the same frame for as long as
+     * the button is held. Events aggregate these repeated frames:
+     *
+     * - EVENT_PRESS when a frame is received which differs from the last
+     *   one, or follows it after more than the release timeout
+     * - EVENT_HOLD once the same frame kept coming for the hold timeout
+     * - EVENT_RELEASE when the frame has not been repeated for the release
+     *   timeout, or a different frame arrived
+     */
+    enum EventState {
+        EVENT_PRESS,
+        EVENT_HOLD,
+        EVENT_RELEASE
+    };
+
+    struct Event {
+        unsigned long value;
+        unsigned long firstSeen;    // millis() of the first frame
+        unsigned int bitlength;
+        unsigned int protocol;
+        unsigned int device;        // see getReceivedDevice()
+        unsigned int repeatCount;   // frames received so far
+        EventState state;
+    };
+
+    bool availableEvent();
+    Event getEvent();
+    void resetAvailableEvent();
+    void setEventTimeouts(unsigned int nHoldTimeout, unsigned int nReleaseTimeout);
+    void setEventTimeouts(int nProtocol, unsigned int nHoldTimeout, unsigned int nReleaseTimeout);
+
+    // Receiving from descriptors is available on Linux, but only in the
+    // Raspberry Pi build (-DRPI), which also needs wiringPi
+    #if defined(RaspberryPi)
+    bool enableReceive(const char* sChip, unsigned int nLine);
+    void enableReceiveFd(int fd);
+    int getReceiveFd();
+    int handleEvents();
+
+    bool enableReceiveSamples(unsigned long nSampleRate, bool bIQ);
+    void handleSamples(const uint8_t* samples, size_t nCount);
+    int handleSamples(int fd);
+    #endif
     #endif
   
     void enableTransmit(int nTransmitterPin);
@@ -148,16 +370,107 @@ class RCSwitch {
     void setProtocol(int nProtocol);
     void setProtocol(int nProtocol, int nPulseLength);
 
+    /**
+     * Two levels of a transmission and their durations in microseconds,
+     * with the bit layout of rmt_item32_t of the ESP32 RMT peripheral. With
+     * the RMT channel clocked at 1MHz, a buffer of these can be passed to
+     * rmt_write_items() as it is. A duration of 0 ends the transmission.
+     */
+    struct PulseItem {
+        uint32_t duration0 : 15;
+        uint32_t level0 : 1;
+        uint32_t duration1 : 15;
+        uint32_t level1 : 1;
+    };
+
+    /**
+     * One of the transmissions sent at the same time by sendConcurrent().
+     * The sender provides the pin, protocol and repeat count, as set up by
+     * enableTransmit(), setProtocol() and setRepeatTransmit().
+     */
+    struct Transmission {
+        RCSwitch* sender;
+        unsigned long code;
+        unsigned int length;
+    };
+
+    /**
+     * Called instead of digitalWrite() by sendConcurrent() to simulate the
+     * pins, with the time the edge was scheduled for and the time it would
+     * have been written, both in microseconds since the start of the
+     * transmissions. The simulation runs on a virtual clock: it does not
+     * wait for the edges, and an edge is only late by the time the calls
+     * for the edges before it took.
+     */
+    typedef void (*EdgeCallback)(int nPin, uint8_t nLevel, unsigned long nScheduledTime, unsigned long nActualTime);
+
+    static void sendConcurrent(const Transmission* transmissions, unsigned int nCount, EdgeCallback simulate = 0);
+
+    unsigned int renderItems(unsigned long code, unsigned int length, PulseItem* items, unsigned int nMaxItems);
+    unsigned long renderBitstream(unsigned long code, unsigned int length, unsigned int nResolution,
+                                  uint8_t* buffer, unsigned long nBufferSize);
+
+    /**
+     * Entry of a codebook, which maps received codes to the IDs of known
+     * devices. A received code matches if it was decoded with the given
+     * protocol and bit length, and (received code & mask) == code.
+     *
+     * The mask allows one entry to cover e.g. all buttons of a remote, by
+     * only comparing the address bits. If several entries match, the one
+     * with the numerically largest mask wins, so an entry for a single
+     * button takes precedence over one for the whole remote.
+     */
+    struct CodebookEntry {
+        uint32_t code;
+        uint32_t mask;
+        uint16_t device;
+        uint8_t protocol;
+        uint8_t bitlength;
+    };
+
+    #if not defined( RCSwitchDisableReceiving )
+    void setCodebook(const CodebookEntry* entries, unsigned int nCount, bool bFilterUnknown);
+    static unsigned int lookupCodebook(unsigned int nProtocol, unsigned int nBitlength, unsigned long code);
+    static void sortCodebook(CodebookEntry* entries, unsigned int nCount);
+    #if defined(RaspberryPi)
+    static const CodebookEntry* mapCodebook(const char* sPath, unsigned int* pnCount);
+    #endif
+    #endif
+
   private:
-    char* getCodeWordA(const char* sGroup, const char* sDevice, bool bStatus);
-    char* getCodeWordB(int nGroupNumber, int nSwitchNumber, bool bStatus);
-    char* getCodeWordC(char sFamily, int nGroup, int nDevice, bool bStatus);
-    char* getCodeWordD(char group, int nDevice, bool bStatus);
+    /* helper functions for the code word encoders, all append n tristate
+     * symbols to acc */
+
+    /* "0" (switch off) becomes F, anything else 0 */
+    static constexpr unsigned long dipSwitchTristate(const char* s, int n, unsigned long acc) {
+        return (n == 0) ? acc : dipSwitchTristate(s + 1, n - 1, (acc << 2) | ((*s == '0') ? 0x1UL : 0x0UL));
+    }
+
+    /* the lowest n bits of v, least significant first, 1 becomes F */
+    static constexpr unsigned long bitsTristate(unsigned int v, int n, unsigned long acc) {
+        return (n == 0) ? acc : bitsTristate(v >> 1, n - 1, (acc << 2) | (v & 0x1UL));
+    }
+
+    static constexpr CodeWord codeWordDIndex(int nGroup, int nDevice, bool bStatus) {
+        return (nGroup < 0 || nGroup > 3 || nDevice < 1 || nDevice > 3) ? CodeWord{ 0, 0 } :
+               CodeWord{ ((0x55UL | (3UL << (2 * (3 - nGroup)))) << 16) |
+                         ((0x15UL | (3UL << (2 * (3 - nDevice)))) << 10) |
+                         (bStatus ? 0xCUL : 0x3UL), 24 };
+    }
+
     void transmit(HighLow pulses);
+    int pauseReceive();
+    void resumeReceive(int nReceiverInterrupt_backup);
+    static HighLow pulseAt(const Protocol& protocol, unsigned long code, unsigned int length, unsigned int k);
 
     #if not defined( RCSwitchDisableReceiving )
     static void handleInterrupt();
+    static void handleTiming(unsigned int duration);
+    static Timing quantizeTiming(unsigned int duration);
+    static unsigned int timingAt(unsigned int i);
     static bool receiveProtocol(const int p, unsigned int changeCount);
+    static void recordEvent(const int p);
+    static void pushEvent(EventState state);
     int nReceiverInterrupt;
     #endif
     int nTransmitterPin;
@@ -171,11 +484,57 @@ class RCSwitch {
     volatile static unsigned int nReceivedBitlength;
     volatile static unsigned int nReceivedDelay;
     volatile static unsigned int nReceivedProtocol;
+    volatile static unsigned int nReceivedDevice;
     const static unsigned int nSeparationLimit;
     /* 
      * timings[0] contains sync timing, followed by a number of bits
      */
-    static unsigned int timings[RCSWITCH_MAX_CHANGES];
+    static Timing timings[RCSWITCH_MAX_CHANGES];
+
+    /* sorted codebook, see setCodebook() and RCSWITCH_CODEBOOK_ATTR */
+    static const CodebookEntry* codebook;
+    static unsigned int nCodebookSize;
+    static bool bCodebookFilter;
+
+    /* press in progress and queue of events, see availableEvent(). The
+     * decoder only gets to recordEvent() through eventRecorder, which is
+     * set by the event API, so that sketches not using events do not
+     * link it. */
+    static void (*eventRecorder)(const int p);
+    static Event currentEvent;
+    static unsigned long nLastSeen;
+    static bool bEventActive;
+    static Event events[RCSWITCH_MAX_EVENTS];
+    volatile static uint8_t nEventTail;
+    volatile static uint8_t nEventCount;
+
+    #if defined(RaspberryPi)
+    /* GPIO line event descriptor, see enableReceive(const char*, unsigned int) */
+    int nReceiverFd;
+    uint64_t nLastEventTime;
+    uint8_t eventBuffer[64 * 16];  // struct gpioevent_data read but not decoded yet
+    unsigned int nEventStart;
+    unsigned int nEventEnd;
+
+    /**
+     * State of the OOK envelope detector which turns raw receiver samples
+     * into edge timings, see handleSamples().
+     */
+    struct SampleState {
+        unsigned long rate;
+        bool iq;
+        int pending;           // buffered I byte of an incomplete I/Q pair, or -1
+        uint8_t smoothShift;   // time constant of the envelope filter
+        uint8_t trackShift;    // time constant of the peak / noise floor trackers
+        int32_t envelope;      // all levels are magnitudes scaled by 16
+        int32_t peak;          // peak and noise floor also have 16 fractional bits
+        int32_t floor;
+        bool level;
+        unsigned long run;     // samples since the last level change
+        unsigned long microsPerSample;  // 16.16 fixed point
+    };
+    SampleState sampleState;
+    #endif
     #endif
 
     
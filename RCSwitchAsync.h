@@ -0,0 +1,400 @@
+/*
+  RCSwitchAsync - C++20 coroutine interface of RCSwitch for Linux hosts
+
+  Project home: https://github.com/sui77/rc-switch/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef _RCSwitchAsync_h
+#define _RCSwitchAsync_h
+
+#include "RCSwitch.h"
+
+#if defined(RaspberryPi) && __cplusplus >= 202002L
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/**
+ * Return type of fire-and-forget coroutines. The coroutine starts running
+ * immediately and frees itself when it finishes.
+ *
+ *   RCSwitchTask blink(RCSwitchTransmitter& tx) {
+ *     for (;;) {
+ *       co_await tx.send(5393, 24);
+ *       ...
+ *     }
+ *   }
+ */
+struct RCSwitchTask {
+    struct promise_type {
+        RCSwitchTask get_return_object() { return RCSwitchTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/**
+ * Single threaded event loop on top of epoll. While nothing is pending the
+ * thread sleeps in epoll_wait(), so an idle gateway uses no CPU at all.
+ */
+class RCSwitchEventLoop {
+
+  public:
+    /**
+     * Gets notified while the descriptor it watches is readable.
+     */
+    struct Waiter {
+        virtual void onReadable() = 0;
+    };
+
+    RCSwitchEventLoop() {
+        this->nEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        this->nStopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        this->bStopped = false;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = this->nStopFd;
+        epoll_ctl(this->nEpollFd, EPOLL_CTL_ADD, this->nStopFd, &ev);
+    }
+
+    ~RCSwitchEventLoop() {
+        close(this->nStopFd);
+        close(this->nEpollFd);
+    }
+
+    /**
+     * Call waiter->onReadable() whenever fd is readable, until remove(fd).
+     * There can be one waiter per descriptor.
+     */
+    void add(int fd, Waiter* waiter) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        this->waiters[fd] = waiter;
+        if (epoll_ctl(this->nEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            epoll_ctl(this->nEpollFd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+
+    void remove(int fd) {
+        this->waiters.erase(fd);
+        epoll_ctl(this->nEpollFd, EPOLL_CTL_DEL, fd, NULL);
+    }
+
+    /**
+     * co_await loop.readable(fd) suspends until fd is readable, e.g. for a
+     * network socket.
+     */
+    auto readable(int fd) {
+        struct Awaiter : Waiter {
+            RCSwitchEventLoop* loop;
+            int fd;
+            std::coroutine_handle<> handle;
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                this->handle = h;
+                this->loop->add(this->fd, this);
+            }
+            void await_resume() {}
+            void onReadable() override {
+                this->loop->remove(this->fd);
+                this->handle.resume();
+            }
+        };
+        Awaiter awaiter;
+        awaiter.loop = this;
+        awaiter.fd = fd;
+        return awaiter;
+    }
+
+    /**
+     * Dispatch events until stop() is called.
+     */
+    void run() {
+        while (!this->bStopped) {
+            struct epoll_event events[16];
+            const int n = epoll_wait(this->nEpollFd, events, 16, -1);
+            for (int i = 0; i < n && !this->bStopped; i++) {
+                const int fd = events[i].data.fd;
+                if (fd == this->nStopFd) {
+                    RCSwitchEventLoop::drain(this->nStopFd);
+                    continue;
+                }
+                // a coroutine resumed earlier in this batch may have
+                // removed or replaced the waiter
+                std::unordered_map<int, Waiter*>::iterator it = this->waiters.find(fd);
+                if (it != this->waiters.end()) {
+                    it->second->onReadable();
+                }
+            }
+        }
+    }
+
+    /**
+     * Make run() return, may be called from any thread.
+     */
+    void stop() {
+        this->bStopped = true;
+        RCSwitchEventLoop::notify(this->nStopFd);
+    }
+
+    /**
+     * Make the eventfd fd readable. Writing only fails with EAGAIN, if the
+     * counter is saturated, and then it is readable already.
+     */
+    static void notify(int fd) {
+        const uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN) {
+            std::terminate();
+        }
+    }
+
+    /**
+     * Reset the non-blocking eventfd fd.
+     *
+     * @return false if it was not readable
+     */
+    static bool drain(int fd) {
+        uint64_t value;
+        if (read(fd, &value, sizeof(value)) == sizeof(value)) {
+            return true;
+        }
+        if (errno != EAGAIN) {
+            std::terminate();
+        }
+        return false;
+    }
+
+  private:
+    int nEpollFd;
+    int nStopFd;
+    std::atomic<bool> bStopped;
+    std::unordered_map<int, Waiter*> waiters;
+};
+
+/**
+ * Awaitable receiver on top of an RCSwitch receiving through a descriptor,
+ * see RCSwitch::enableReceive(const char*, unsigned int).
+ *
+ *   RCSwitchReceiver rx(loop, mySwitch);
+ *   RCSwitchReceiver::Frame frame = co_await rx.nextFrame();
+ */
+class RCSwitchReceiver {
+
+  public:
+    struct Frame {
+        unsigned long value;
+        unsigned int bitlength;   // 0 if the receive descriptor failed
+        unsigned int delay;
+        unsigned int protocol;
+    };
+
+    RCSwitchReceiver(RCSwitchEventLoop& loop, RCSwitch& rcswitch) : loop(loop), rcswitch(rcswitch) {
+    }
+
+    auto nextFrame() {
+        struct Awaiter : RCSwitchEventLoop::Waiter {
+            RCSwitchReceiver* rx;
+            std::coroutine_handle<> handle;
+            Frame frame;
+
+            bool await_ready() {
+                return this->poll();
+            }
+            void await_suspend(std::coroutine_handle<> h) {
+                this->handle = h;
+                this->rx->loop.add(this->rx->rcswitch.getReceiveFd(), this);
+            }
+            Frame await_resume() {
+                return this->frame;
+            }
+            void onReadable() override {
+                if (this->poll()) {
+                    this->rx->loop.remove(this->rx->rcswitch.getReceiveFd());
+                    this->handle.resume();
+                }
+            }
+
+            bool poll() {
+                RCSwitch& rcswitch = this->rx->rcswitch;
+                if (!rcswitch.available() && rcswitch.handleEvents() < 0) {
+                    this->frame.value = 0;
+                    this->frame.bitlength = 0;
+                    this->frame.delay = 0;
+                    this->frame.protocol = 0;
+                    return true;
+                }
+                if (!rcswitch.available()) {
+                    return false;
+                }
+                this->frame.value = rcswitch.getReceivedValue();
+                this->frame.bitlength = rcswitch.getReceivedBitlength();
+                this->frame.delay = rcswitch.getReceivedDelay();
+                this->frame.protocol = rcswitch.getReceivedProtocol();
+                rcswitch.resetAvailable();
+                return true;
+            }
+        };
+        Awaiter awaiter;
+        awaiter.rx = this;
+        return awaiter;
+    }
+
+  private:
+    RCSwitchEventLoop& loop;
+    RCSwitch& rcswitch;
+};
+
+/**
+ * Awaitable transmitter. RCSwitch::send() bit-bangs the code and blocks for
+ * its whole duration, so it runs on a worker thread; the coroutine is
+ * resumed on the event loop once the code went out. Sends are done one
+ * after the other in the order they were requested.
+ *
+ * The RCSwitch object must not be the one a RCSwitchReceiver uses, as the
+ * worker thread would then touch the receive descriptor concurrently.
+ *
+ * Destroying the transmitter drops the sends still queued and destroys the
+ * coroutines waiting for them, they are never resumed.
+ *
+ *   RCSwitchTransmitter tx(loop, mySwitch);
+ *   co_await tx.send(5393, 24);
+ */
+class RCSwitchTransmitter : RCSwitchEventLoop::Waiter {
+
+  public:
+    RCSwitchTransmitter(RCSwitchEventLoop& loop, RCSwitch& rcswitch) : loop(loop), rcswitch(rcswitch) {
+        this->nDoneFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        this->bStopping = false;
+        this->loop.add(this->nDoneFd, this);
+        this->worker = std::thread(&RCSwitchTransmitter::work, this);
+    }
+
+    ~RCSwitchTransmitter() {
+        {
+            std::lock_guard<std::mutex> lock(this->lock);
+            this->bStopping = true;
+            this->signal.notify_one();
+        }
+        this->worker.join();
+        this->loop.remove(this->nDoneFd);
+        close(this->nDoneFd);
+
+        // the worker is gone, so the queues are ours now
+        for (size_t i = 0; i < this->pending.size(); i++) {
+            this->pending[i].handle.destroy();
+        }
+        for (size_t i = 0; i < this->done.size(); i++) {
+            this->done[i].destroy();
+        }
+    }
+
+    auto send(unsigned long code, unsigned int length) {
+        struct Awaiter {
+            RCSwitchTransmitter* tx;
+            unsigned long code;
+            unsigned int length;
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                std::lock_guard<std::mutex> lock(this->tx->lock);
+                Request request = { this->code, this->length, h };
+                this->tx->pending.push_back(request);
+                this->tx->signal.notify_one();
+            }
+            void await_resume() {}
+        };
+        Awaiter awaiter;
+        awaiter.tx = this;
+        awaiter.code = code;
+        awaiter.length = length;
+        return awaiter;
+    }
+
+  private:
+    struct Request {
+        unsigned long code;
+        unsigned int length;
+        std::coroutine_handle<> handle;
+    };
+
+    void work() {
+        for (;;) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(this->lock);
+                this->signal.wait(lock, [this] { return this->bStopping || !this->pending.empty(); });
+                if (this->bStopping) {
+                    return;
+                }
+                request = this->pending.front();
+                this->pending.pop_front();
+            }
+
+            this->rcswitch.send(request.code, request.length);
+
+            {
+                std::lock_guard<std::mutex> lock(this->lock);
+                this->done.push_back(request.handle);
+            }
+            RCSwitchEventLoop::notify(this->nDoneFd);
+        }
+    }
+
+    void onReadable() override {
+        if (!RCSwitchEventLoop::drain(this->nDoneFd)) {
+            return;
+        }
+
+        std::deque<std::coroutine_handle<> > resume;
+        {
+            std::lock_guard<std::mutex> lock(this->lock);
+            resume.swap(this->done);
+        }
+        for (size_t i = 0; i < resume.size(); i++) {
+            resume[i].resume();
+        }
+    }
+
+    RCSwitchEventLoop& loop;
+    RCSwitch& rcswitch;
+    int nDoneFd;
+    bool bStopping;
+    std::mutex lock;
+    std::condition_variable signal;
+    std::deque<Request> pending;
+    std::deque<std::coroutine_handle<> > done;
+    std::thread worker;
+};
+
+#endif
+
+#endif
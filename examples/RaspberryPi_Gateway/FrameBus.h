@@ -0,0 +1,172 @@
+/*
+  Shared memory frame bus of the rc-switch gateway
+
+  https://github.com/sui77/rc-switch/
+
+  The gateway is the only writer. It publishes each received frame into a
+  ring of slots in a POSIX shared memory object. Any number of readers map
+  the object read-only, keep their own cursor and read the frames in place,
+  no socket or pipe is involved. A reader that falls more than
+  RCSWITCH_BUS_SLOTS frames behind skips the frames it missed.
+
+  Every slot carries the number of the frame it holds plus one, written
+  last by the gateway. While the slot is rewritten it carries the bare
+  number of the new frame, which no reader of that slot expects. A reader
+  accepts a slot only if that number is the expected one before and after
+  copying the frame out.
+
+  Frame numbers are 32 bit and wrap around. 64 bit atomics are not lock
+  free on every Raspberry Pi (ARMv6), and falling back to the process local
+  locks of libatomic would break the synchronization between processes.
+*/
+#ifndef _FrameBus_h
+#define _FrameBus_h
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define RCSWITCH_BUS_NAME "/rc-switch"
+#define RCSWITCH_BUS_MAGIC 0x52434231  // "RCB1"
+#define RCSWITCH_BUS_SLOTS 256         // must be a power of two
+
+struct BusFrame {
+    uint64_t timestamp;   // CLOCK_REALTIME, nanoseconds
+    uint64_t value;
+    uint16_t bitlength;
+    uint16_t protocol;
+    uint16_t delay;       // pulse length in microseconds
+};
+
+struct BusSlot {
+    std::atomic<uint32_t> seq;
+    BusFrame frame;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the frame bus needs lock free 32 bit atomics");
+
+struct FrameBus {
+    uint32_t magic;
+    uint32_t slots;
+    std::atomic<uint32_t> head;      // number of frames published so far
+    std::atomic<uint32_t> wake;      // futex word, bumped on every publish
+    BusSlot slot[RCSWITCH_BUS_SLOTS];
+};
+
+static inline long busFutex(const std::atomic<uint32_t>* addr, int op, uint32_t val, const struct timespec* timeout) {
+    return syscall(SYS_futex, (const uint32_t*)addr, op, val, timeout, NULL, 0);
+}
+
+/**
+ * Create (writer) or open (reader) the bus, returns NULL on error.
+ */
+static inline FrameBus* busOpen(bool bWriter) {
+    const int fd = shm_open(RCSWITCH_BUS_NAME, bWriter ? (O_CREAT | O_RDWR) : O_RDONLY, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (bWriter && ftruncate(fd, sizeof(FrameBus)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    // the writer may not have sized the object yet, mapping it anyway
+    // would raise SIGBUS on the first access
+    struct stat st;
+    if (!bWriter && (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(FrameBus))) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(FrameBus), bWriter ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    FrameBus* bus = (FrameBus*)p;
+    if (bWriter) {
+        memset(p, 0, sizeof(FrameBus));
+        bus->slots = RCSWITCH_BUS_SLOTS;
+        std::atomic_thread_fence(std::memory_order_release);
+        bus->magic = RCSWITCH_BUS_MAGIC;
+    } else if (bus->magic != RCSWITCH_BUS_MAGIC || bus->slots != RCSWITCH_BUS_SLOTS) {
+        munmap(p, sizeof(FrameBus));
+        return NULL;
+    }
+    return bus;
+}
+
+/**
+ * Publish a frame, only to be called by the single writer.
+ */
+static inline void busPublish(FrameBus* bus, const BusFrame& frame) {
+    const uint32_t n = bus->head.load(std::memory_order_relaxed);
+    BusSlot& slot = bus->slot[n & (RCSWITCH_BUS_SLOTS - 1)];
+
+    slot.seq.store(n, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.frame = frame;
+    slot.seq.store(n + 1, std::memory_order_release);
+    bus->head.store(n + 1, std::memory_order_release);
+
+    // frames arrive a few times per second at most, so waking
+    // unconditionally is cheaper than having readers register
+    bus->wake.fetch_add(1, std::memory_order_release);
+    busFutex(&bus->wake, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+/**
+ * Read the frame at *pCursor, advancing the cursor.
+ *
+ * @return false if no frame is pending
+ */
+static inline bool busRead(const FrameBus* bus, uint32_t* pCursor, BusFrame* pFrame) {
+    for (;;) {
+        const uint32_t head = bus->head.load(std::memory_order_acquire);
+        const uint32_t behind = head - *pCursor;
+        if (behind > 0x80000000UL) {
+            // the cursor is ahead, the gateway was restarted
+            *pCursor = head;
+        } else if (behind > RCSWITCH_BUS_SLOTS) {
+            // overrun, the oldest frames are gone
+            *pCursor = head - RCSWITCH_BUS_SLOTS;
+        }
+        if (*pCursor == head) {
+            return false;
+        }
+
+        const BusSlot& slot = bus->slot[*pCursor & (RCSWITCH_BUS_SLOTS - 1)];
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        *pFrame = slot.frame;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq == (uint32_t)(*pCursor + 1) && slot.seq.load(std::memory_order_relaxed) == seq) {
+            (*pCursor)++;
+            return true;
+        }
+        // slot was being overwritten, start over from the current head
+    }
+}
+
+/**
+ * Sleep until a frame after *pCursor is published or the timeout (in
+ * milliseconds, -1 for none) expires.
+ */
+static inline void busWait(const FrameBus* bus, const uint32_t* pCursor, int nTimeout) {
+    const uint32_t wake = bus->wake.load(std::memory_order_acquire);
+    if (bus->head.load(std::memory_order_acquire) != *pCursor) {
+        return;
+    }
+    struct timespec ts = { nTimeout / 1000, (nTimeout % 1000) * 1000000L };
+    busFutex(&bus->wake, FUTEX_WAIT, wake, (nTimeout < 0) ? NULL : &ts);
+}
+
+#endif
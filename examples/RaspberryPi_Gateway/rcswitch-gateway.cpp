@@ -0,0 +1,280 @@
+/*
+  Gateway daemon for the Raspberry Pi
+
+  https://github.com/sui77/rc-switch/
+
+  Owns the receiver and the transmitter, so that any number of local
+  processes can use them at the same time:
+
+  - a receive thread sleeps in poll() on the GPIO line event descriptor,
+    decodes the kernel timestamped edges and publishes every received frame
+    on the shared memory bus described in FrameBus.h
+  - a socket thread accepts send requests as datagrams on a Unix socket
+  - a transmit thread works off the queued requests one after the other
+
+  A send request is a line of text "<code> <bitlength> [protocol [repeat]]",
+  answered with "ok" or "error", e.g.
+
+    echo "5393 24 1" | socat - UNIX-SENDTO:/run/rc-switch.sock,bind=/tmp/c
+
+  Frames heard while we transmit are our own and are not published.
+
+  Build:
+    g++ -O2 -std=c++11 -DRPI -I../.. rcswitch-gateway.cpp ../../RCSwitch.cpp \
+        -o rcswitch-gateway -lwiringPi -lpthread -lrt
+
+  Usage:
+    rcswitch-gateway [-c /dev/gpiochip0] [-r rx line] [-t tx pin] [-s socket]
+
+  Receive line and transmit pin both use BCM GPIO numbers.
+*/
+
+#include "RCSwitch.h"
+#include "FrameBus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#define MAX_PENDING_REQUESTS 32
+
+struct SendRequest {
+    unsigned long code;
+    unsigned int length;
+    int protocol;
+    int repeat;
+};
+
+static RCSwitch receiver;
+static RCSwitch transmitter;
+static FrameBus* bus;
+
+static int stopFd;
+static std::atomic<bool> stopping(false);
+
+static std::mutex queueLock;
+static std::condition_variable queueSignal;
+static std::deque<SendRequest> queue;
+
+// CLOCK_MONOTONIC milliseconds until which received frames are our own
+static std::atomic<uint64_t> transmitUntil(0);
+
+static uint64_t now(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void receiveThread() {
+    struct pollfd fds[2] = {
+        { receiver.getReceiveFd(), POLLIN, 0 },
+        { stopFd, POLLIN, 0 },
+    };
+
+    while (!stopping) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+        // handleEvents() stops at each decoded frame, so when we were
+        // slow to wake up and several are queued, none of them is lost
+        for (;;) {
+            if (receiver.handleEvents() < 0) {
+                perror("rcswitch-gateway: receive");
+                return;
+            }
+            if (!receiver.available()) {
+                break;
+            }
+            if (now(CLOCK_MONOTONIC) / 1000000 >= transmitUntil) {
+                BusFrame frame;
+                frame.timestamp = now(CLOCK_REALTIME);
+                frame.value = receiver.getReceivedValue();
+                frame.bitlength = receiver.getReceivedBitlength();
+                frame.protocol = receiver.getReceivedProtocol();
+                frame.delay = receiver.getReceivedDelay();
+                busPublish(bus, frame);
+            }
+            receiver.resetAvailable();
+        }
+    }
+}
+
+static void transmitThread() {
+    // bit banging needs the CPU exactly when the next edge is due
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    for (;;) {
+        SendRequest request;
+        {
+            std::unique_lock<std::mutex> lock(queueLock);
+            queueSignal.wait(lock, [] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            request = queue.front();
+            queue.pop_front();
+        }
+
+        transmitUntil = UINT64_MAX;
+        transmitter.setProtocol(request.protocol);
+        transmitter.setRepeatTransmit(request.repeat);
+        transmitter.send(request.code, request.length);
+        // the receiver reports a frame after the gap following it
+        transmitUntil = now(CLOCK_MONOTONIC) / 1000000 + 100;
+    }
+}
+
+static bool parseRequest(char* sLine, SendRequest* pRequest) {
+    pRequest->protocol = 1;
+    pRequest->repeat = 10;
+    const int n = sscanf(sLine, "%lu %u %d %d", &pRequest->code, &pRequest->length,
+                         &pRequest->protocol, &pRequest->repeat);
+    return n >= 2 && pRequest->length >= 1 && pRequest->length <= 32 &&
+           pRequest->repeat >= 1 && pRequest->repeat <= 100;
+}
+
+static void socketThread(int sock) {
+    struct pollfd fds[2] = {
+        { sock, POLLIN, 0 },
+        { stopFd, POLLIN, 0 },
+    };
+
+    while (!stopping) {
+        if (poll(fds, 2, -1) < 0 || fds[0].revents == 0) {
+            continue;
+        }
+
+        char sLine[128];
+        struct sockaddr_un from;
+        socklen_t fromLength = sizeof(from);
+        const ssize_t n = recvfrom(sock, sLine, sizeof(sLine) - 1, 0, (struct sockaddr*)&from, &fromLength);
+        if (n < 0) {
+            continue;
+        }
+        sLine[n] = '\0';
+
+        SendRequest request;
+        bool ok = parseRequest(sLine, &request);
+        if (ok) {
+            std::lock_guard<std::mutex> lock(queueLock);
+            if (queue.size() < MAX_PENDING_REQUESTS) {
+                queue.push_back(request);
+                queueSignal.notify_one();
+            } else {
+                ok = false;
+            }
+        }
+
+        if (fromLength > sizeof(sa_family_t)) {
+            const char* sReply = ok ? "ok\n" : "error\n";
+            sendto(sock, sReply, strlen(sReply), 0, (struct sockaddr*)&from, fromLength);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* sChip = "/dev/gpiochip0";
+    unsigned int nReceiveLine = 27;
+    int nTransmitPin = 17;
+    const char* sSocket = "/run/rc-switch.sock";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:r:t:s:")) != -1) {
+        switch (opt) {
+            case 'c': sChip = optarg; break;
+            case 'r': nReceiveLine = atoi(optarg); break;
+            case 't': nTransmitPin = atoi(optarg); break;
+            case 's': sSocket = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-c chip] [-r rx line] [-t tx pin] [-s socket]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (wiringPiSetupGpio() == -1) {
+        fprintf(stderr, "rcswitch-gateway: wiringPi setup failed\n");
+        return 1;
+    }
+    if (!receiver.enableReceive(sChip, nReceiveLine)) {
+        perror("rcswitch-gateway: cannot request receive line");
+        return 1;
+    }
+    transmitter.enableTransmit(nTransmitPin);
+
+    bus = busOpen(true);
+    if (bus == NULL) {
+        perror("rcswitch-gateway: cannot create frame bus");
+        return 1;
+    }
+
+    const int sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sSocket, sizeof(addr.sun_path) - 1);
+    unlink(sSocket);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("rcswitch-gateway: cannot bind socket");
+        return 1;
+    }
+    chmod(sSocket, 0666);
+
+    // handle SIGINT / SIGTERM in main only, the threads inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0) {
+        perror("rcswitch-gateway: cannot create stop event");
+        return 1;
+    }
+    std::thread rx(receiveThread);
+    std::thread tx(transmitThread);
+    std::thread sk(socketThread, sock);
+
+    int sig;
+    sigwait(&signals, &sig);
+
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        stopping = true;
+        queueSignal.notify_all();
+    }
+    const uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) != sizeof(one)) {
+        // the receive and socket threads would never wake up to join
+        perror("rcswitch-gateway: cannot stop threads");
+        shm_unlink(RCSWITCH_BUS_NAME);
+        unlink(sSocket);
+        _exit(1);
+    }
+    rx.join();
+    tx.join();
+    sk.join();
+
+    receiver.disableReceive();
+    close(sock);
+    unlink(sSocket);
+    shm_unlink(RCSWITCH_BUS_NAME);
+    return 0;
+}
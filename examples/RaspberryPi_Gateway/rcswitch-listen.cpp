@@ -0,0 +1,39 @@
+/*
+  Print the frames received by rcswitch-gateway
+
+  https://github.com/sui77/rc-switch/
+
+  Any number of these can run next to each other, each reads the frames
+  straight from the shared memory bus of the gateway.
+
+  Build:
+    g++ -O2 -std=c++11 rcswitch-listen.cpp -o rcswitch-listen -lrt
+*/
+
+#include "FrameBus.h"
+
+#include <stdio.h>
+
+int main() {
+    const FrameBus* bus = busOpen(false);
+    if (bus == NULL) {
+        perror("rcswitch-listen: cannot open frame bus, is rcswitch-gateway running?");
+        return 1;
+    }
+
+    // only report frames received from now on
+    uint32_t cursor = bus->head.load();
+
+    for (;;) {
+        busWait(bus, &cursor, -1);
+
+        BusFrame frame;
+        while (busRead(bus, &cursor, &frame)) {
+            printf("%llu.%03u Received %llu / %ubit Protocol: %u PulseLength: %u\n",
+                   (unsigned long long)(frame.timestamp / 1000000000ULL),
+                   (unsigned int)(frame.timestamp / 1000000ULL % 1000),
+                   (unsigned long long)frame.value, frame.bitlength, frame.protocol, frame.delay);
+        }
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,464 @@
+/*
+  Self test of the Linux receive paths and of sendConcurrent()
+
+  https://github.com/sui77/rc-switch/
+
+  Feeds synthesized signals into the decoder and simulates the transmitter
+  pins, no radio hardware is needed. Prints one line per check and exits
+  with status 1 if any of them failed.
+
+  Build (with -std=c++11 the check of RCSwitchAsync.h is left out):
+    g++ -O2 -std=c++20 -DRPI -I../.. rcswitch-selftest.cpp ../../RCSwitch.cpp \
+        -o rcswitch-selftest -lwiringPi -lpthread
+*/
+
+#include "RCSwitch.h"
+#include "RCSwitchAsync.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <linux/gpio.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool ok, const char* sName) {
+    printf("%s %s\n", ok ? "ok    " : "FAILED", sName);
+    if (!ok) {
+        failures++;
+    }
+}
+
+/*
+ * The pulses of a protocol 1 transmission, in microseconds
+ */
+static void pulses(std::vector<unsigned long>& durations, unsigned long code, unsigned int length, int nRepeat) {
+    const RCSwitch::HighLow zero = { 1, 3 }, one = { 3, 1 }, sync = { 1, 31 };
+    for (int n = 0; n < nRepeat; n++) {
+        for (int i = length - 1; i >= 0; i--) {
+            const RCSwitch::HighLow pulse = (code & (1UL << i)) ? one : zero;
+            durations.push_back(350 * pulse.high);
+            durations.push_back(350 * pulse.low);
+        }
+        durations.push_back(350 * sync.high);
+        durations.push_back(350 * sync.low);
+    }
+}
+
+/*
+ * Amplitude samples at 1 MS/s, i.e. one sample per microsecond
+ */
+struct Signal {
+    std::vector<uint8_t> samples;
+    unsigned int seed;
+
+    Signal() : seed(1) {
+    }
+
+    // a little noise, so that the trackers see a real noise floor
+    uint8_t noisy(int amplitude) {
+        seed = seed * 1103515245 + 12345;
+        const int v = amplitude + (int)((seed >> 16) % 7) - 3;
+        return (v < 0) ? 0 : (v > 255) ? 255 : v;
+    }
+
+    void level(int amplitude, unsigned long duration) {
+        for (unsigned long i = 0; i < duration; i++) {
+            samples.push_back(noisy(amplitude));
+        }
+    }
+
+    // repeated frames, like a remote sends them
+    void frames(unsigned long code, unsigned int length, int carrier, int floor) {
+        std::vector<unsigned long> durations;
+        pulses(durations, code, length, 6);
+        for (size_t i = 0; i < durations.size(); i++) {
+            level((i % 2 == 0) ? carrier : floor, durations[i]);
+        }
+    }
+};
+
+static unsigned long decode(RCSwitch& rx, const Signal& signal) {
+    rx.resetAvailable();
+    // blocks of odd size, as they come from a pipe
+    for (size_t i = 0; i < signal.samples.size(); i += 4093) {
+        const size_t n = (signal.samples.size() - i < 4093) ? signal.samples.size() - i : 4093;
+        rx.handleSamples(&signal.samples[i], n);
+    }
+    return rx.available() ? rx.getReceivedValue() : 0;
+}
+
+static void checkSamples() {
+    RCSwitch rx;
+    check(!rx.enableReceiveSamples(0, false), "sample rate 0 is rejected");
+
+    rx.enableReceiveSamples(1000000, false);
+    Signal strong;
+    strong.level(10, 100000);
+    strong.frames(5393, 24, 250, 10);
+    check(decode(rx, strong) == 5393, "strong transmitter");
+
+    // a weaker transmitter, after 2s of silence
+    Signal weak;
+    weak.level(10, 2000000);
+    weak.frames(4433, 24, 60, 10);
+    check(decode(rx, weak) == 4433, "weak transmitter after a strong one");
+
+    RCSwitch fresh;
+    fresh.enableReceiveSamples(1000000, false);
+    check(decode(fresh, weak) == 4433, "weak transmitter alone");
+
+    // the same as rtl_sdr I/Q pairs, carrier in phase with I
+    Signal iq;
+    for (size_t i = 0; i < strong.samples.size(); i++) {
+        iq.samples.push_back(128 + strong.samples[i] / 2);
+        iq.samples.push_back(128);
+    }
+    RCSwitch sdr;
+    sdr.enableReceiveSamples(1000000, true);
+    check(decode(sdr, iq) == 5393, "I/Q samples");
+}
+
+/*
+ * Line events of the given pulses, as the GPIO chardev would deliver them
+ */
+static void writeEvents(int fd, const std::vector<unsigned long>& durations) {
+    uint64_t time = 1000000000ULL;
+    for (size_t i = 0; i < durations.size(); i++) {
+        struct gpioevent_data event;
+        memset(&event, 0, sizeof(event));
+        event.timestamp = time;
+        event.id = (i % 2 == 0) ? GPIOEVENT_EVENT_FALLING_EDGE : GPIOEVENT_EVENT_RISING_EDGE;
+        time += durations[i] * 1000;
+        if (write(fd, &event, sizeof(event)) != sizeof(event)) {
+            check(false, "write");
+        }
+    }
+}
+
+static void checkEvents() {
+    // two different frames, both queued before the receiver gets to them
+    std::vector<unsigned long> durations;
+    durations.push_back(20000);
+    pulses(durations, 0xA5, 8, 3);
+    pulses(durations, 0x5A, 8, 3);
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        check(false, "pipe");
+        return;
+    }
+    writeEvents(fds[1], durations);
+    close(fds[1]);
+
+    RCSwitch rx;
+    rx.enableReceiveFd(fds[0]);
+    std::vector<unsigned long> received;
+    while (rx.handleEvents() >= 0) {
+        if (rx.available()) {
+            received.push_back(rx.getReceivedValue());
+            rx.resetAvailable();
+        }
+    }
+    check(received.size() == 2 && received[0] == 0xA5 && received[1] == 0x5A, "every frame of one batch of edges");
+    rx.disableReceive();
+}
+
+static void checkCodebook() {
+    // a whole remote, one of its buttons, and the same with the entries
+    // given the other way round
+    RCSwitch::CodebookEntry entries[][2] = {
+        { { 0x51F2C0, 0xFFFFF0, 1, 1, 24 }, { 0x51F2C3, 0xFFFFFF, 2, 1, 24 } },
+        { { 0x51F2C3, 0xFFFFFF, 2, 1, 24 }, { 0x51F2C0, 0xFFFFF0, 1, 1, 24 } },
+    };
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        RCSwitch::sortCodebook(entries[i], 2);
+        RCSwitch rx;
+        rx.setCodebook(entries[i], 2, false);
+        ok = ok && RCSwitch::lookupCodebook(1, 24, 0x51F2C3) == 2 && RCSwitch::lookupCodebook(1, 24, 0x51F2C5) == 1 &&
+             RCSwitch::lookupCodebook(1, 24, 0x41F2C3) == RCSWITCH_NO_DEVICE;
+    }
+    check(ok, "codebook entry with the largest mask wins");
+}
+
+#if __cplusplus >= 202002L
+static RCSwitchTask receiveFrames(RCSwitchEventLoop& loop, RCSwitchReceiver& rx, std::vector<unsigned long>& received,
+                                  size_t nFrames) {
+    while (received.size() < nFrames) {
+        const RCSwitchReceiver::Frame frame = co_await rx.nextFrame();
+        if (frame.bitlength == 0) {
+            break;
+        }
+        received.push_back(frame.value);
+    }
+    loop.stop();
+}
+
+/*
+ * Stops the loop if the frames do not arrive
+ */
+struct Timeout : RCSwitchEventLoop::Waiter {
+    RCSwitchEventLoop* loop;
+
+    void onReadable() override {
+        this->loop->stop();
+    }
+};
+
+static void checkCoroutine() {
+    // several frames in one batch of less than 64 events; the pipe stays
+    // open and is drained by the first read(), so the later frames have to
+    // come from what the receiver buffered, without another wake up
+    std::vector<unsigned long> durations;
+    durations.push_back(20000);
+    pulses(durations, 0x5, 4, 2);
+    pulses(durations, 0xA, 4, 2);
+    pulses(durations, 0x3, 4, 2);
+
+    // the frames the blocking loop of checkEvents() decodes from them
+    int fds[2];
+    if (pipe(fds) < 0) {
+        check(false, "pipe");
+        return;
+    }
+    writeEvents(fds[1], durations);
+    close(fds[1]);
+    std::vector<unsigned long> expected;
+    RCSwitch reference;
+    reference.enableReceiveFd(fds[0]);
+    while (reference.handleEvents() >= 0) {
+        if (reference.available()) {
+            expected.push_back(reference.getReceivedValue());
+            reference.resetAvailable();
+        }
+    }
+    reference.disableReceive();
+
+    if (pipe2(fds, O_NONBLOCK) < 0) {
+        check(false, "pipe");
+        return;
+    }
+    writeEvents(fds[1], durations);
+
+    RCSwitchEventLoop loop;
+    Timeout timeout;
+    timeout.loop = &loop;
+    const int nTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = 2;
+    timerfd_settime(nTimerFd, 0, &spec, NULL);
+    loop.add(nTimerFd, &timeout);
+
+    RCSwitch rcswitch;
+    rcswitch.enableReceiveFd(fds[0]);
+    RCSwitchReceiver rx(loop, rcswitch);
+    std::vector<unsigned long> received;
+    receiveFrames(loop, rx, received, expected.size());
+    loop.run();
+
+    check(expected.size() >= 2 && received == expected, "co_await nextFrame() on one batch of frames");
+    loop.remove(nTimerFd);
+    close(nTimerFd);
+    rcswitch.disableReceive();
+    close(fds[1]);
+}
+#endif
+
+/*
+ * Protocols 1, 6 and 9, copied from proto[] in RCSwitch.cpp, so that the
+ * rendered transmissions are checked against the table itself
+ */
+struct ProtocolRow {
+    int nProtocol;
+    unsigned long sync[2], zero[2], one[2];
+    bool invertedSignal;
+};
+static const ProtocolRow rows[] = {
+    { 1, {   1, 31 }, {  1, 3 }, {  3, 1 }, false },
+    { 6, {  23,  1 }, {  1, 2 }, {  2, 1 }, true },
+    { 9, { 130,  7 }, { 16, 7 }, { 16, 3 }, true },
+};
+
+struct Level {
+    uint8_t level;
+    unsigned long duration;
+};
+
+/*
+ * The levels send() transmits, each bit MSB first and the sync after them
+ */
+static std::vector<Level> levels(const ProtocolRow& row, unsigned long nPulseLength, unsigned long code,
+                                 unsigned int length, int nRepeat) {
+    const uint8_t first = row.invertedSignal ? LOW : HIGH;
+    std::vector<Level> result;
+    for (int n = 0; n < nRepeat; n++) {
+        for (unsigned int i = 0; i <= length; i++) {
+            const unsigned long* factors = (i == length) ? row.sync : ((code >> (length - 1 - i)) & 1) ? row.one : row.zero;
+            const Level high = { first, nPulseLength * factors[0] };
+            const Level low = { (uint8_t)!first, nPulseLength * factors[1] };
+            result.push_back(high);
+            result.push_back(low);
+        }
+    }
+    return result;
+}
+
+static void checkRender() {
+    // pulse lengths chosen so that 1100 * 31 and 300 * 130 exceed an item
+    // half, and 353 does not divide into 10us samples
+    struct Case {
+        const ProtocolRow* row;
+        unsigned long nPulseLength;
+    };
+    const Case cases[] = {
+        { &rows[0], 353 }, { &rows[0], 1100 }, { &rows[1], 450 }, { &rows[2], 300 },
+    };
+    const unsigned long code = 5393;
+    const unsigned int length = 24;
+
+    bool bItems = true, bInverted = true, bSplit = true, bStream1 = true, bStream10 = true;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const ProtocolRow& row = *cases[c].row;
+        RCSwitch tx;
+        tx.setProtocol(row.nProtocol, cases[c].nPulseLength);
+        tx.setRepeatTransmit(2);
+        const std::vector<Level> expected = levels(row, cases[c].nPulseLength, code, length, 2);
+
+        // items: every level in halves of at most 32767us, the halves of
+        // one level in a row, then a zero duration half ends it
+        std::vector<RCSwitch::PulseItem> items(tx.renderItems(code, length, 0, 0));
+        tx.renderItems(code, length, &items[0], items.size());
+        std::vector<Level> halves;
+        for (size_t k = 0; k < items.size(); k++) {
+            const Level first = { (uint8_t)items[k].level0, items[k].duration0 };
+            const Level second = { (uint8_t)items[k].level1, items[k].duration1 };
+            halves.push_back(first);
+            halves.push_back(second);
+        }
+        size_t h = 0;
+        bool ok = true, bWasSplit = false;
+        for (size_t k = 0; ok && k < expected.size(); k++) {
+            unsigned long duration = 0;
+            for (int nParts = 0; h < halves.size() && halves[h].duration != 0 && halves[h].level == expected[k].level &&
+                                 duration < expected[k].duration; nParts++, h++) {
+                duration += halves[h].duration;
+                bWasSplit = bWasSplit || nParts > 0;
+            }
+            ok = duration == expected[k].duration;
+        }
+        ok = ok && (h == halves.size() || (h + 1 == halves.size() && halves[h].duration == 0));
+        bItems = bItems && ok;
+        if (row.invertedSignal) {
+            bInverted = bInverted && ok && halves[0].level == LOW;
+        }
+        if (cases[c].nPulseLength * row.sync[0] > 32767 || cases[c].nPulseLength * row.sync[1] > 32767) {
+            bSplit = bSplit && ok && bWasSplit;
+        }
+
+        // bitstreams: each edge at the sample nearest to its exact time
+        for (unsigned int nResolution = 1; nResolution <= 10; nResolution += 9) {
+            std::vector<uint8_t> buffer((tx.renderBitstream(code, length, nResolution, 0, 0) + 7) / 8);
+            const unsigned long nBits = tx.renderBitstream(code, length, nResolution, &buffer[0], buffer.size());
+            unsigned long time = 0, bit = 0;
+            ok = true;
+            for (size_t k = 0; ok && k < expected.size(); k++) {
+                time += expected[k].duration;
+                const unsigned long edge = time / nResolution + (time % nResolution >= (nResolution + 1) / 2 ? 1 : 0);
+                for (; ok && bit < edge; bit++) {
+                    ok = ((buffer[bit / 8] >> (7 - bit % 8)) & 1) == expected[k].level;
+                }
+            }
+            ok = ok && nBits == bit;
+            if (nResolution == 1) {
+                bStream1 = bStream1 && ok;
+            } else {
+                bStream10 = bStream10 && ok;
+            }
+        }
+    }
+    check(bItems, "items match the protocol table");
+    check(bInverted, "items of inverted protocols");
+    check(bSplit, "levels longer than 32767us split across items");
+    check(bStream1, "bitstream at 1us resolution");
+    check(bStream10, "bitstream at 10us resolution, edges at the nearest sample");
+}
+
+/*
+ * Edges sendConcurrent() would have written, per pin
+ */
+struct Edge {
+    uint8_t level;
+    unsigned long scheduled;
+    unsigned long actual;
+};
+static std::vector<Edge> edges[2];
+
+static void simulate(int nPin, uint8_t nLevel, unsigned long nScheduledTime, unsigned long nActualTime) {
+    const Edge edge = { nLevel, nScheduledTime, nActualTime };
+    edges[nPin - 10].push_back(edge);
+}
+
+static void checkConcurrent() {
+    RCSwitch tx[2];
+    tx[0].enableTransmit(10);
+    tx[1].enableTransmit(11);
+    tx[1].setProtocol(2);
+    tx[1].setRepeatTransmit(3);
+    const RCSwitch::Transmission transmissions[] = {
+        { &tx[0], 5393, 24 },
+        { &tx[1], 703710, 20 },
+    };
+    for (int i = 0; i < 2; i++) {
+        edges[i].clear();
+        edges[i].reserve(2000);
+    }
+    RCSwitch::sendConcurrent(transmissions, 2, simulate);
+
+    for (int i = 0; i < 2; i++) {
+        // the schedule of each pin has to match its own transmission
+        // exactly, no matter how the edges of both interleave
+        std::vector<RCSwitch::PulseItem> items(tx[i].renderItems(transmissions[i].code, transmissions[i].length, 0, 0));
+        tx[i].renderItems(transmissions[i].code, transmissions[i].length, &items[0], items.size());
+        bool ok = (edges[i].size() == 2 * items.size() + 1);
+        for (size_t k = 0; ok && k + 1 < edges[i].size(); k++) {
+            const RCSwitch::PulseItem& item = items[k / 2];
+            const unsigned long duration = (k % 2 == 0) ? item.duration0 : item.duration1;
+            const uint8_t level = (k % 2 == 0) ? item.level0 : item.level1;
+            ok = edges[i][k].level == level && edges[i][k + 1].scheduled - edges[i][k].scheduled == duration;
+        }
+        check(ok, "schedule of each transmitter");
+
+        // only for information: the simulation runs on a virtual clock, so
+        // edges are only late by what writing the ones before them took
+        unsigned long lateness = 0;
+        unsigned int nLate = 0;
+        for (size_t k = 0; k < edges[i].size(); k++) {
+            const unsigned long late = edges[i][k].actual - edges[i][k].scheduled;
+            if (late > lateness) {
+                lateness = late;
+            }
+            if (late > 50) {
+                nLate++;
+            }
+        }
+        printf("       pin %d: %u edges, %u of them more than 50us late, at most %luus\n",
+               10 + i, (unsigned int)edges[i].size(), nLate, lateness);
+    }
+}
+
+int main() {
+    checkSamples();
+    checkEvents();
+    checkCodebook();
+#if __cplusplus >= 202002L
+    checkCoroutine();
+#endif
+    checkRender();
+    checkConcurrent();
+    return (failures > 0) ? 1 : 0;
+}
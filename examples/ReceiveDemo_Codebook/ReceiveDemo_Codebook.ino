@@ -0,0 +1,59 @@
+/*
+  Example for resolving received codes to known devices
+  
+  https://github.com/sui77/rc-switch/
+*/
+
+#include <RCSwitch.h>
+
+RCSwitch mySwitch = RCSwitch();
+
+// Device IDs used in this sketch
+enum { FRONT_DOOR = 1, BACK_DOOR = 2, HALLWAY_PIR = 3, REMOTE = 4 };
+
+// Entries must be sorted by protocol, bit length, mask (largest first) and
+// code, with the code bits outside the mask cleared (see
+// RCSwitch::sortCodebook()).
+// The remote only has its 20 address bits compared, the lowest 4 bits
+// tell which of its buttons was pressed. An entry with a larger mask, e.g.
+// for a single button of it, would take precedence.
+// RCSWITCH_CODEBOOK_ATTR puts the table in flash on AVR, but keeps it in
+// RAM on ESP, where the receive interrupt must not read from flash.
+const RCSwitch::CodebookEntry codebook[] RCSWITCH_CODEBOOK_ATTR = {
+  // code      mask        device        protocol  bitlength
+  { 0x0A3B11, 0xFFFFFF,   FRONT_DOOR,   1,        24 },
+  { 0x0A3B14, 0xFFFFFF,   BACK_DOOR,    1,        24 },
+  { 0x7C0155, 0xFFFFFF,   HALLWAY_PIR,  1,        24 },
+  { 0x51F2C0, 0xFFFFF0,   REMOTE,       1,        24 },
+};
+
+void setup() {
+  Serial.begin(9600);
+  mySwitch.enableReceive(0);  // Receiver on interrupt 0 => that is pin #2
+
+  // Drop codes of the neighbours' devices right away
+  mySwitch.setCodebook(codebook, sizeof(codebook) / sizeof(codebook[0]), true);
+}
+
+void loop() {
+  if (mySwitch.available()) {
+
+    switch (mySwitch.getReceivedDevice()) {
+      case FRONT_DOOR:
+        Serial.println("Front door opened");
+        break;
+      case BACK_DOOR:
+        Serial.println("Back door opened");
+        break;
+      case HALLWAY_PIR:
+        Serial.println("Motion in the hallway");
+        break;
+      case REMOTE:
+        Serial.print("Remote button ");
+        Serial.println( mySwitch.getReceivedValue() & 0xF );
+        break;
+    }
+
+    mySwitch.resetAvailable();
+  }
+}
@@ -0,0 +1,44 @@
+/*
+  Example for receiving button presses instead of single frames
+  
+  https://github.com/sui77/rc-switch/
+*/
+
+#include <RCSwitch.h>
+
+RCSwitch mySwitch = RCSwitch();
+
+void setup() {
+  Serial.begin(9600);
+  mySwitch.enableReceive(0);  // Receiver on interrupt 0 => that is pin #2
+
+  // Optional set hold and release timeouts in milliseconds.
+  // mySwitch.setEventTimeouts(500, 250);
+}
+
+void loop() {
+  if (mySwitch.availableEvent()) {
+    RCSwitch::Event event = mySwitch.getEvent();
+
+    switch (event.state) {
+      case RCSwitch::EVENT_PRESS:
+        Serial.print("Pressed ");
+        break;
+      case RCSwitch::EVENT_HOLD:
+        Serial.print("Holding ");
+        break;
+      case RCSwitch::EVENT_RELEASE:
+        Serial.print("Released ");
+        break;
+    }
+    Serial.print( event.value );
+    Serial.print(" / ");
+    Serial.print( event.bitlength );
+    Serial.print("bit Protocol: ");
+    Serial.print( event.protocol );
+    Serial.print(" Frames: ");
+    Serial.println( event.repeatCount );
+
+    mySwitch.resetAvailableEvent();
+  }
+}
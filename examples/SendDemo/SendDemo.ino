@@ -9,6 +9,10 @@
 
 RCSwitch mySwitch = RCSwitch();
 
+// Code words of a fixed switch can be computed at compile time
+constexpr RCSwitch::CodeWord switchOnCode = RCSwitch::codeWordA("11111", "00010", true);
+constexpr RCSwitch::CodeWord switchOffCode = RCSwitch::codeWordA("11111", "00010", false);
+
 void setup() {
 
   Serial.begin(9600);
@@ -35,6 +39,12 @@ void loop() {
   mySwitch.switchOff("11111", "00010");
   delay(1000);
 
+  /* Same switch as above, but using the precomputed code words */
+  mySwitch.send(switchOnCode);
+  delay(1000);
+  mySwitch.send(switchOffCode);
+  delay(1000);
+
   /* Same switch as above, but using decimal code */
   mySwitch.send(5393, 24);
   delay(1000);  
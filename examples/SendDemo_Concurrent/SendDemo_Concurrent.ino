@@ -0,0 +1,35 @@
+/*
+  Example for sending on two transmitters at the same time
+  
+  https://github.com/sui77/rc-switch/
+*/
+
+#include <RCSwitch.h>
+
+RCSwitch switch433 = RCSwitch();
+RCSwitch switch315 = RCSwitch();
+
+void setup() {
+
+  // 433MHz transmitter is connected to Arduino Pin #10
+  switch433.enableTransmit(10);
+
+  // 315MHz transmitter is connected to Arduino Pin #11, the devices
+  // listening there use protocol 2
+  switch315.enableTransmit(11);
+  switch315.setProtocol(2);
+  switch315.setRepeatTransmit(15);
+}
+
+void loop() {
+
+  // Both codes go out at the same time, each with the protocol and
+  // repeat count of its own transmitter
+  RCSwitch::Transmission transmissions[] = {
+    { &switch433, 5393, 24 },
+    { &switch315, 703710, 20 },
+  };
+  RCSwitch::sendConcurrent(transmissions, 2);
+
+  delay(1000);
+}